@@ -62,7 +62,8 @@ typedef enum _ENetSocketOption
    ENET_SOCKOPT_RCVTIMEO  = 6,
    ENET_SOCKOPT_SNDTIMEO  = 7,
    ENET_SOCKOPT_ERROR     = 8,
-   ENET_SOCKOPT_NODELAY   = 9
+   ENET_SOCKOPT_NODELAY   = 9,
+   ENET_SOCKOPT_DONTFRAGMENT = 10
 } ENetSocketOption;
 
 typedef enum _ENetSocketShutdown
@@ -72,6 +73,14 @@ typedef enum _ENetSocketShutdown
     ENET_SOCKET_SHUTDOWN_READ_WRITE = 2
 } ENetSocketShutdown;
 
+/**
+ * Opaque set of sockets waited on together for readability, backed by epoll
+ * where available so that one thread can service many hosts.
+ *
+ * @sa enet_socket_waiter_create()
+ */
+typedef struct _ENetSocketWaiter ENetSocketWaiter;
+
 #define ENET_HOST_ANY       0
 #define ENET_HOST_BROADCAST 0xFFFFFFFFU
 #define ENET_PORT_ANY       0
@@ -122,6 +131,8 @@ typedef enum _ENetPacketFlag
 
 typedef void (ENET_CALLBACK * ENetPacketFreeCallback) (struct _ENetPacket *);
 
+typedef struct _ENetPool ENetPool;
+
 /**
  * ENet packet structure.
  *
@@ -153,6 +164,7 @@ typedef struct _ENetPacket
    size_t                   dataLength;      /**< length of data */
    ENetPacketFreeCallback   freeCallback;    /**< function to be called when the packet is no longer in use */
    void *                   userData;        /**< application private data, may be freely modified */
+   ENetPool *               pool;            /**< internal use only, the pool the packet was allocated from */
 } ENetPacket;
 
 typedef struct _ENetAcknowledgement
@@ -168,13 +180,17 @@ typedef struct _ENetOutgoingCommand
    enet_uint16  reliableSequenceNumber;
    enet_uint16  unreliableSequenceNumber;
    enet_uint32  sentTime;
+   enet_uint32  sentTimeMicroseconds;
    enet_uint32  roundTripTimeout;
    enet_uint32  roundTripTimeoutLimit;
    enet_uint32  fragmentOffset;
    enet_uint16  fragmentLength;
    enet_uint16  sendAttempts;
+   enet_uint16  inTransit;
+   enet_uint16  sentOrder;
    ENetProtocol command;
    ENetPacket * packet;
+   struct _ENetOutgoingCommand * nextReliableCommand;
 } ENetOutgoingCommand;
 
 typedef struct _ENetIncomingCommand
@@ -215,6 +231,7 @@ enum
    ENET_HOST_DEFAULT_MTU                  = 1400,
    ENET_HOST_DEFAULT_MAXIMUM_PACKET_SIZE  = 32 * 1024 * 1024,
    ENET_HOST_DEFAULT_MAXIMUM_WAITING_DATA = 32 * 1024 * 1024,
+   ENET_HOST_MAXIMUM_BATCH_SIZE           = 64,
 
    ENET_PEER_DEFAULT_ROUND_TRIP_TIME      = 500,
    ENET_PEER_DEFAULT_PACKET_THROTTLE      = 32,
@@ -235,7 +252,17 @@ enum
    ENET_PEER_FREE_UNSEQUENCED_WINDOWS     = 32,
    ENET_PEER_RELIABLE_WINDOWS             = 16,
    ENET_PEER_RELIABLE_WINDOW_SIZE         = 0x1000,
-   ENET_PEER_FREE_RELIABLE_WINDOWS        = 8
+   ENET_PEER_FREE_RELIABLE_WINDOWS        = 8,
+   ENET_PEER_SENT_RELIABLE_RING_SIZE      = 0x2000,
+   ENET_PEER_MTU_PROBE_ATTEMPTS           = 3,
+   ENET_PEER_MTU_PROBE_GRANULARITY        = 32,
+   ENET_PEER_MTU_PROBE_MINIMUM_TIMEOUT    = 100,
+   ENET_PEER_CONGESTION_INITIAL_WINDOW    = 10 * ENET_HOST_DEFAULT_MTU,
+   ENET_PEER_CONGESTION_MAXIMUM_WINDOW    = 4 * 1024 * 1024,
+   ENET_PEER_CONGESTION_MINIMUM_RTT_INTERVAL = 10000,
+   ENET_PEER_PACING_BURST                 = 4,
+   ENET_PEER_PACING_INTERVAL              = 2000,
+   ENET_PEER_FAST_RETRANSMIT_THRESHOLD    = 3
 };
 
 typedef struct _ENetChannel
@@ -248,11 +275,32 @@ typedef struct _ENetChannel
    enet_uint16  incomingUnreliableSequenceNumber;
    ENetList     incomingReliableCommands;
    ENetList     incomingUnreliableCommands;
+   ENetIncomingCommand ** incomingReliableRing;     /**< queued reliable commands less than a reliable window ahead, indexed by sequence number, allocated on first use */
+   enet_uint32 *          incomingReliableSlots;    /**< bitmap of the occupied slots of incomingReliableRing */
+   size_t                 incomingReliableOverflow; /**< queued reliable commands too far ahead to be held in incomingReliableRing */
+   ENetOutgoingCommand ** sentReliableRing;         /**< sent reliable commands awaiting acknowledgement, indexed by sequence number, allocated on first use */
+   enet_uint16 *          sentReliableOrder;        /**< sequence numbers of the reliable commands in the order they were sent or resent, allocated with sentReliableRing */
+   enet_uint16            sentReliableOrderBegin;   /**< sentOrder of the oldest transmission in sentReliableOrder */
+   enet_uint16            sentReliableOrderEnd;     /**< sentOrder of the next transmission */
 } ENetChannel;
 
+/**
+ * How the reliable data a peer may have in transit is limited, see enet_host_congestion_control().
+ */
+typedef enum _ENetCongestionControl
+{
+   /** the negotiated window scaled by the packet throttle, the classic ENet behaviour */
+   ENET_CONGESTION_CONTROL_THROTTLE = 0,
+
+   /** a congestion window grown along a cubic curve (as TCP CUBIC), cut back on loss and held
+     * while round trip times show that a queue builds up along the path */
+   ENET_CONGESTION_CONTROL_CUBIC    = 1
+} ENetCongestionControl;
+
 typedef enum _ENetPeerFlag
 {
-   ENET_PEER_FLAG_NEEDS_DISPATCH = (1 << 0)
+   ENET_PEER_FLAG_NEEDS_DISPATCH      = (1 << 0),
+   ENET_PEER_FLAG_ACKNOWLEDGE_RANGES  = (1 << 1)  /**< both hosts agreed on acknowledging runs of commands with one ACKNOWLEDGE_RANGE */
 } ENetPeerFlag;
 
 /**
@@ -289,6 +337,8 @@ typedef struct _ENetPeer
    enet_uint32   packetsLost;
    enet_uint32   packetLoss;          /**< mean packet loss of reliable packets as a ratio with respect to the constant ENET_PEER_PACKET_LOSS_SCALE */
    enet_uint32   packetLossVariance;
+   enet_uint32   fastRetransmits;     /**< reliable commands resent because later ones on their channel were acknowledged, since the peer was reset */
+   enet_uint32   timeoutRetransmits;  /**< reliable commands resent because their round trip timeout expired, since the peer was reset */
    enet_uint32   packetThrottle;
    enet_uint32   packetThrottleLimit;
    enet_uint32   packetThrottleCounter;
@@ -300,21 +350,43 @@ typedef struct _ENetPeer
    enet_uint32   timeoutLimit;
    enet_uint32   timeoutMinimum;
    enet_uint32   timeoutMaximum;
-   enet_uint32   lastRoundTripTime;
+   enet_uint32   lastRoundTripTime;        /**< throttle statistics, in microseconds */
    enet_uint32   lowestRoundTripTime;
    enet_uint32   lastRoundTripTimeVariance;
    enet_uint32   highestRoundTripTimeVariance;
    enet_uint32   roundTripTime;            /**< mean round trip time (RTT), in milliseconds, between sending a reliable packet and receiving its acknowledgement */
    enet_uint32   roundTripTimeVariance;
+   enet_uint32   roundTripTimeMicroseconds; /**< mean round trip time in microseconds, roundTripTime rounded up from it */
+   enet_uint32   roundTripTimeVarianceMicroseconds;
    enet_uint32   mtu;
+   enet_uint32   mtuProbeLimit;            /**< largest datagram size left to probe the path for, 0 unless probing, see enet_host_mtu() */
+   enet_uint32   mtuProbeSize;             /**< datagram size being probed, 0 if none */
+   enet_uint32   mtuProbeTimeout;          /**< when the probe of mtuProbeSize is given up as lost */
+   enet_uint16   mtuProbeSequenceNumber;
+   enet_uint16   mtuProbeAttempts;
    enet_uint32   windowSize;
    enet_uint32   reliableDataInTransit;
+   enet_uint32   congestionWindow;         /**< reliable data allowed in transit, unless the host uses ENET_CONGESTION_CONTROL_THROTTLE */
+   enet_uint32   congestionThreshold;      /**< slow start ends once congestionWindow reaches this */
+   enet_uint32   congestionWindowMaximum;  /**< congestionWindow before the last reduction, the plateau of the cubic curve */
+   enet_uint32   congestionEpoch;          /**< time of the last reduction of congestionWindow */
+   enet_uint32   congestionPlateauTime;    /**< milliseconds after congestionEpoch at which the cubic curve reaches its plateau */
+   enet_uint32   congestionUndoWindow;     /**< congestionWindow before the last reduction, restored if that reduction turns out spurious, 0 if none */
+   enet_uint32   congestionUndoThreshold;
+   enet_uint32   congestionUndoWindowMaximum;
+   enet_uint32   congestionUndoEpoch;
+   enet_uint32   congestionUndoPlateauTime;
+   enet_uint32   minimumRoundTripTime;     /**< lowest round trip time sample, in microseconds */
+   enet_uint32   minimumRoundTripTimeEpoch;
+   enet_uint32   pacingTokens;             /**< bytes the peer may still be sent right away, see enet_host_pacing() */
+   enet_uint32   pacingTimeMicroseconds;   /**< serviceTimeMicroseconds at which pacingTokens were last refilled */
    enet_uint16   outgoingReliableSequenceNumber;
    ENetList      acknowledgements;
    ENetList      sentReliableCommands;
    ENetList      sentUnreliableCommands;
    ENetList      outgoingCommands;
    ENetList      dispatchedCommands;
+   ENetOutgoingCommand * sentUnindexedCommands; /**< sent commands awaiting acknowledgement that no channel ring holds, chained: the system commands, or those of a channel whose ring could not be allocated */
    enet_uint16   flags;
    enet_uint16   reserved;
    enet_uint16   incomingUnsequencedGroup;
@@ -356,9 +428,16 @@ typedef int (ENET_CALLBACK * ENetInterceptCallback) (struct _ENetHost * host, st
     @sa enet_host_broadcast()
     @sa enet_host_compress()
     @sa enet_host_compress_with_range_coder()
+    @sa enet_host_compress_with_lz_coder()
     @sa enet_host_channel_limit()
     @sa enet_host_bandwidth_limit()
     @sa enet_host_bandwidth_throttle()
+    @sa enet_host_receive_batch()
+    @sa enet_host_send_batch()
+    @sa enet_host_mtu()
+    @sa enet_host_congestion_control()
+    @sa enet_host_pacing()
+    @sa enet_host_acknowledge_ranges()
   */
 typedef struct _ENetHost
 {
@@ -368,12 +447,18 @@ typedef struct _ENetHost
    enet_uint32          outgoingBandwidth;           /**< upstream bandwidth of the host */
    enet_uint32          bandwidthThrottleEpoch;
    enet_uint32          mtu;
+   int                  mtuProbing;                  /**< whether peers probe the path MTU once connected, see enet_host_mtu() */
+   ENetCongestionControl congestionControl;          /**< how reliable data in transit is limited, see enet_host_congestion_control() */
+   int                  pacing;                      /**< whether datagrams to each peer are spread over its round trip time, see enet_host_pacing() */
+   int                  acknowledgeRanges;           /**< whether runs of commands are acknowledged as ranges to peers that agree, see enet_host_acknowledge_ranges() */
+   enet_uint32          pacingTimeout;               /**< earliest time a peer held back by pacing may be sent to again, 0 if none is held back */
    enet_uint32          randomSeed;
    int                  recalculateBandwidthLimits;
    ENetPeer *           peers;                       /**< array of peers allocated for this host */
    size_t               peerCount;                   /**< number of peers allocated for this host */
    size_t               channelLimit;                /**< maximum number of channels allowed for connected peers */
    enet_uint32          serviceTime;
+   enet_uint32          serviceTimeMicroseconds;     /**< microsecond clock read together with serviceTime */
    ENetList             dispatchQueue;
    int                  continueSending;
    size_t               packetSize;
@@ -398,6 +483,22 @@ typedef struct _ENetHost
    size_t               duplicatePeers;              /**< optional number of allowed peers from duplicate IPs, defaults to ENET_PROTOCOL_MAXIMUM_PEER_ID */
    size_t               maximumPacketSize;           /**< the maximum allowable packet size that may be sent or received on a peer */
    size_t               maximumWaitingData;          /**< the maximum aggregate amount of buffer space a peer may use waiting for packets to be delivered */
+   ENetBuffer *         receiveBatchBuffers;         /**< MTU sized buffers filled by one batched receive, NULL unless enabled with enet_host_receive_batch() */
+   ENetAddress *        receiveBatchAddresses;
+   size_t *             receiveBatchLengths;
+   size_t               receiveBatchSize;
+   size_t               receiveBatchCount;           /**< datagrams returned by the last batched receive */
+   size_t               receiveBatchIndex;           /**< next datagram of the last batched receive to be handled */
+   ENetBuffer *         sendBatchBuffers;            /**< datagrams queued during one service pass, NULL unless enabled with enet_host_send_batch() */
+   ENetAddress *        sendBatchAddresses;
+   size_t               sendBatchSize;
+   size_t               sendBatchCount;
+   int                  sendBatchSegmentation;       /**< whether runs of equally sized datagrams to one peer are sent as one UDP GSO buffer */
+   ENetPool *           outgoingCommandPool;         /**< per host object pools, NULL unless enabled with enet_host_pool() */
+   ENetPool *           incomingCommandPool;
+   ENetPool *           acknowledgementPool;
+   ENetPool *           packetPool;
+   size_t               packetPoolDataLength;        /**< payloads up to this length are stored inside pooled packets */
 } ENetHost;
 
 /**
@@ -482,14 +583,19 @@ ENET_API ENetVersion enet_linked_version (void);
 /** @defgroup private ENet private implementation functions */
 
 /**
-  Returns the wall-time in milliseconds.  Its initial value is unspecified
-  unless otherwise set.
+  Returns the time in milliseconds, from a monotonic clock where the system
+  has one.  Its initial value is unspecified unless otherwise set.
   */
 ENET_API enet_uint32 enet_time_get (void);
 /**
-  Sets the current wall-time in milliseconds.
+  Sets the current time in milliseconds.
   */
 ENET_API void enet_time_set (enet_uint32);
+/**
+  Returns enet_time_get() and stores a microsecond clock with an unspecified
+  origin, wrapping at 32 bits, read at the same moment.
+  */
+extern enet_uint32 enet_time_get_precise (enet_uint32 *);
 
 /** @defgroup socket ENet socket functions
     @{
@@ -502,6 +608,8 @@ ENET_API ENetSocket enet_socket_accept (ENetSocket, ENetAddress *);
 ENET_API int        enet_socket_connect (ENetSocket, const ENetAddress *);
 ENET_API int        enet_socket_send (ENetSocket, const ENetAddress *, const ENetBuffer *, size_t);
 ENET_API int        enet_socket_receive (ENetSocket, ENetAddress *, ENetBuffer *, size_t);
+ENET_API int        enet_socket_receive_batch (ENetSocket, ENetAddress *, ENetBuffer *, size_t *, size_t);
+ENET_API int        enet_socket_send_batch (ENetSocket, const ENetAddress *, const ENetBuffer *, size_t, int *);
 ENET_API int        enet_socket_wait (ENetSocket, enet_uint32 *, enet_uint32);
 ENET_API int        enet_socket_set_option (ENetSocket, ENetSocketOption, int);
 ENET_API int        enet_socket_get_option (ENetSocket, ENetSocketOption, int *);
@@ -509,6 +617,12 @@ ENET_API int        enet_socket_shutdown (ENetSocket, ENetSocketShutdown);
 ENET_API void       enet_socket_destroy (ENetSocket);
 ENET_API int        enet_socketset_select (ENetSocket, ENetSocketSet *, ENetSocketSet *, enet_uint32);
 
+ENET_API ENetSocketWaiter * enet_socket_waiter_create (void);
+ENET_API void               enet_socket_waiter_destroy (ENetSocketWaiter *);
+ENET_API int                enet_socket_waiter_add (ENetSocketWaiter *, ENetSocket, void *);
+ENET_API int                enet_socket_waiter_remove (ENetSocketWaiter *, ENetSocket);
+ENET_API int                enet_socket_waiter_wait (ENetSocketWaiter *, void **, size_t, enet_uint32);
+
 /** @} */
 
 /** @defgroup Address ENet address functions
@@ -561,18 +675,29 @@ ENET_API ENetPacket * enet_packet_create (const void *, size_t, enet_uint32);
 ENET_API void         enet_packet_destroy (ENetPacket *);
 ENET_API int          enet_packet_resize  (ENetPacket *, size_t);
 ENET_API enet_uint32  enet_crc32 (const ENetBuffer *, size_t);
+extern   void         enet_crc32_initialize (void);
                 
 ENET_API ENetHost * enet_host_create (const ENetAddress *, size_t, size_t, enet_uint32, enet_uint32);
 ENET_API void       enet_host_destroy (ENetHost *);
 ENET_API ENetPeer * enet_host_connect (ENetHost *, const ENetAddress *, size_t, enet_uint32);
 ENET_API int        enet_host_check_events (ENetHost *, ENetEvent *);
 ENET_API int        enet_host_service (ENetHost *, ENetEvent *, enet_uint32);
+ENET_API enet_uint32 enet_host_service_timeout (ENetHost *, enet_uint32);
 ENET_API void       enet_host_flush (ENetHost *);
 ENET_API void       enet_host_broadcast (ENetHost *, enet_uint8, ENetPacket *);
 ENET_API void       enet_host_compress (ENetHost *, const ENetCompressor *);
 ENET_API int        enet_host_compress_with_range_coder (ENetHost * host);
+ENET_API int        enet_host_compress_with_lz_coder (ENetHost * host, const void * dictionary, size_t dictionaryLength);
 ENET_API void       enet_host_channel_limit (ENetHost *, size_t);
 ENET_API void       enet_host_bandwidth_limit (ENetHost *, enet_uint32, enet_uint32);
+ENET_API int        enet_host_receive_batch (ENetHost *, size_t);
+ENET_API int        enet_host_send_batch (ENetHost *, size_t, int);
+ENET_API int        enet_host_pool (ENetHost *, int, size_t);
+ENET_API int        enet_host_mtu (ENetHost *, enet_uint32, int);
+ENET_API void       enet_host_congestion_control (ENetHost *, ENetCongestionControl);
+ENET_API void       enet_host_pacing (ENetHost *, int);
+ENET_API void       enet_host_acknowledge_ranges (ENetHost *, int);
+ENET_API ENetPacket * enet_host_packet_create (ENetHost *, const void *, size_t, enet_uint32);
 extern   void       enet_host_bandwidth_throttle (ENetHost *);
 extern  enet_uint32 enet_host_random_seed (void);
 extern  enet_uint32 enet_host_random (ENetHost *);
@@ -588,13 +713,19 @@ ENET_API void                enet_peer_disconnect_now (ENetPeer *, enet_uint32);
 ENET_API void                enet_peer_disconnect_later (ENetPeer *, enet_uint32);
 ENET_API void                enet_peer_throttle_configure (ENetPeer *, enet_uint32, enet_uint32, enet_uint32);
 extern int                   enet_peer_throttle (ENetPeer *, enet_uint32);
+extern void                  enet_peer_congestion_acknowledge (ENetPeer *, enet_uint32, enet_uint32);
+extern void                  enet_peer_congestion_loss (ENetPeer *);
+extern void                  enet_peer_congestion_undo (ENetPeer *);
 extern void                  enet_peer_reset_queues (ENetPeer *);
 extern void                  enet_peer_setup_outgoing_command (ENetPeer *, ENetOutgoingCommand *);
+extern void                  enet_peer_link_reliable_command (ENetPeer *, ENetOutgoingCommand *);
+extern ENetOutgoingCommand ** enet_peer_find_reliable_command (ENetPeer *, enet_uint16, enet_uint8);
 extern ENetOutgoingCommand * enet_peer_queue_outgoing_command (ENetPeer *, const ENetProtocol *, ENetPacket *, enet_uint32, enet_uint16);
 extern ENetIncomingCommand * enet_peer_queue_incoming_command (ENetPeer *, const ENetProtocol *, const void *, size_t, enet_uint32, enet_uint32);
 extern ENetAcknowledgement * enet_peer_queue_acknowledgement (ENetPeer *, const ENetProtocol *, enet_uint16);
 extern void                  enet_peer_dispatch_incoming_unreliable_commands (ENetPeer *, ENetChannel *, ENetIncomingCommand *);
 extern void                  enet_peer_dispatch_incoming_reliable_commands (ENetPeer *, ENetChannel *, ENetIncomingCommand *);
+extern ENetIncomingCommand * enet_peer_find_incoming_reliable_command (ENetChannel *, enet_uint16);
 extern void                  enet_peer_on_connect (ENetPeer *);
 extern void                  enet_peer_on_disconnect (ENetPeer *);
 
@@ -602,9 +733,21 @@ ENET_API void * enet_range_coder_create (void);
 ENET_API void   enet_range_coder_destroy (void *);
 ENET_API size_t enet_range_coder_compress (void *, const ENetBuffer *, size_t, size_t, enet_uint8 *, size_t);
 ENET_API size_t enet_range_coder_decompress (void *, const enet_uint8 *, size_t, enet_uint8 *, size_t);
+
+ENET_API void * enet_lz_coder_create (const void *, size_t);
+ENET_API void   enet_lz_coder_destroy (void *);
+ENET_API size_t enet_lz_coder_compress (void *, const ENetBuffer *, size_t, size_t, enet_uint8 *, size_t);
+ENET_API size_t enet_lz_coder_decompress (void *, const enet_uint8 *, size_t, enet_uint8 *, size_t);
    
 extern size_t enet_protocol_command_size (enet_uint8);
 
+extern ENetPool * enet_pool_create (size_t);
+extern void       enet_pool_destroy (ENetPool *);
+extern void *     enet_pool_allocate (ENetPool *, size_t);
+extern void       enet_pool_free (ENetPool *, void *);
+extern void *     enet_pool_take_buffer (ENetPool *, size_t);
+extern void       enet_pool_keep_buffer (ENetPool *, void *, size_t);
+
 #ifdef __cplusplus
 }
 #endif
@@ -14,6 +14,11 @@
 #include <cstdint>
 #include "base.h"
 
+/*
+ * called from the service thread of the client, a callback may connect,
+ * close or send; init or exit of a client serviced by the same thread,
+ * this one included, would deadlock, so they log an error and fail there
+ */
 struct GOOFER_API EnetClientSink
 {
     virtual ~EnetClientSink();
@@ -21,8 +26,90 @@ struct GOOFER_API EnetClientSink
     virtual void on_enet_close() = 0;
     virtual void on_enet_error(const char * action, const char * message) = 0;
     virtual void on_enet_recv(const void * data, uint32_t size) = 0;
+    virtual void on_enet_recv(const void * data, uint32_t size, uint8_t channel); /* default forwards to on_enet_recv(data, size) */
 };
 
+enum class EnetDelivery : uint8_t
+{
+    reliable,                   /* ordered, resent until acknowledged */
+    unreliable,                 /* ordered, dropped if late or lost */
+    unsequenced,                /* neither ordered nor resent */
+    unreliable_fragment         /* like unreliable, but large messages are fragmented without falling back to reliable */
+};
+
+enum class EnetCompression : uint8_t
+{
+    none,
+    range_coder,                /* enet's adaptive range coder, best ratio, slow */
+    lz                          /* fast lz77 coder, optionally primed with a dictionary */
+};
+
+enum class EnetCongestionControl : uint8_t
+{
+    throttle,                   /* enet's packet throttle over a window of at most 64 KiB */
+    cubic                       /* a cubic congestion window, able to fill links with a large bandwidth delay product */
+};
+
+class EnetClientServiceImpl;
+
+/*
+ * threads shared by many enet clients, each thread waits on the sockets of
+ * its clients with one epoll set instead of every client running its own
+ * service thread; exit every client bound to the service before exiting it,
+ * and not from a callback, exit would wait for the thread it runs on
+ */
+class GOOFER_API EnetClientService
+{
+public:
+    EnetClientService();
+    ~EnetClientService();
+
+public:
+    bool init(uint32_t thread_count);
+    void exit();
+
+private:
+    EnetClientService(const EnetClientService &) = delete;
+    EnetClientService(EnetClientService &&) = delete;
+    EnetClientService & operator = (const EnetClientService &) = delete;
+    EnetClientService & operator = (EnetClientService &&) = delete;
+
+private:
+    friend class EnetClientImpl;
+
+private:
+    EnetClientServiceImpl         * m_impl;
+};
+
+struct GOOFER_API EnetClientOptions
+{
+    EnetClientOptions();
+
+    uint8_t                     channel_count;      /* 1 ~ 255, the server may grant fewer */
+    uint32_t                    receive_batch_size; /* datagrams read per system call (recvmmsg), 0 or 1 reads one at a time */
+    uint32_t                    send_batch_size;    /* datagrams sent per system call (sendmmsg), 0 or 1 sends one at a time */
+    bool                        send_segmentation;  /* let the kernel split runs of full datagrams (UDP GSO) when batching sends */
+    bool                        object_pools;       /* allocate enet commands and packets from pools of this client instead of the heap */
+    uint32_t                    mtu;                /* largest datagram payload offered to the server (link mtu - 28), 0 for enet's default of 1400 */
+    bool                        mtu_probing;        /* find out after connect how large a datagram the path carries, up to mtu */
+    EnetCongestionControl       congestion_control; /* how much reliable data may be in transit to the server */
+    bool                        pacing;             /* spread the datagrams of a window over the round trip time instead of sending them in one burst */
+    bool                        acknowledge_ranges; /* acknowledge runs of commands with one range, used only if the server host offers it too */
+    const uint8_t             * fec_group_sizes;    /* channel_count entries, 0 leaves a channel alone, 2 ~ 32 unreliable messages per xor parity message, copied by init, the server must frame the channel the same way, nullptr for none */
+    bool                        checksum;           /* crc32 every datagram (enet_crc32), the server host must use the same checksum */
+    EnetCompression             compression;        /* the server host must use the same compressor (and dictionary) */
+    const void                * compression_dictionary; /* lz only, typical message content, copied by init, nullptr for none */
+    uint32_t                    compression_dictionary_size;
+    EnetClientService         * service;            /* shared service threads, nullptr runs a service thread for this client alone */
+};
+
+/*
+ * releases a buffer handed over by the zero-copy send_message, called once
+ * enet no longer references it, from the enet client service thread (or
+ * from close/exit when the message is discarded)
+ */
+typedef void (*EnetReleaseCallback)(const void * data, uint32_t size, void * context);
+
 class EnetClientImpl;
 
 class GOOFER_API EnetClient
@@ -33,12 +120,16 @@ public:
 
 public:
     bool init(EnetClientSink * sink, const char * host, uint16_t port);
+    bool init(EnetClientSink * sink, const char * host, uint16_t port, const EnetClientOptions & options);
     void exit();
 
 public:
     void connect();
     void close();
-    bool send_message(const void * data, uint32_t size);
+    bool send_message(const void * data, uint32_t size); /* reliable on channel 0 */
+    bool send_message(const void * data, uint32_t size, uint8_t channel, EnetDelivery delivery);
+    bool send_message(const void * data, uint32_t size, EnetReleaseCallback release, void * context); /* takes ownership of data only when returns true */
+    bool send_message(const void * data, uint32_t size, uint8_t channel, EnetDelivery delivery, EnetReleaseCallback release, void * context);
     bool is_connected() const;
 
 private:
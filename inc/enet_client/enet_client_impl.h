@@ -13,10 +13,9 @@
 
 #include <list>
 #include <mutex>
-#include <thread>
+#include <atomic>
 #include <string>
 #include <vector>
-#include <condition_variable>
 
 extern "C"
 {
@@ -24,6 +23,9 @@ extern "C"
 }
 
 #include "enet_client.h"
+#include "enet_send_queue.h"
+#include "enet_fec.h"
+#include "enet_service_loop.h"
 
 class EnetClientImpl
 {
@@ -32,45 +34,57 @@ public:
     ~EnetClientImpl();
 
 public:
-    bool init(EnetClientSink * sink, const char * host, uint16_t port);
+    bool init(EnetClientSink * sink, const char * host, uint16_t port, const EnetClientOptions & options);
     void exit();
 
 public:
     void connect();
     void close();
-    bool send_message(const void * data, uint32_t size);
+    bool send_message(const void * data, uint32_t size, uint8_t channel, EnetDelivery delivery, EnetReleaseCallback release, void * context);
     bool is_connected() const;
+    bool is_service_thread() const; /* true on the thread of the service loop of this client, which exit() cannot run on */
+
+public:
+    uint32_t service(); /* called by the service loop, returns milliseconds until the next service is due */
 
 private:
     void on_connect();
     void on_close();
     void do_connect();
     void do_close();
+    void do_send();
+    void send_fec_parity(uint8_t channel);
+    uint32_t flush_fec(); /* returns milliseconds until the next open group is due */
+    void discard_datagrams();
+    void schedule();
 
 private:
     bool                                                    m_running;
     EnetClientSink                                        * m_sink;
     std::string                                             m_host;
     uint16_t                                                m_port;
+    EnetClientOptions                                       m_options;
     ENetHost                                              * m_enet_host;
     ENetPeer                                              * m_enet_peer;
+    enet_uint32                                             m_connect_deadline;
+    std::atomic<bool>                                       m_connected;
+    std::atomic<uint32_t>                                   m_channel_count;
 
 private:
-    std::list<std::vector<uint8_t>>                         m_send_data_list;
-    std::mutex                                              m_send_data_mutex;
-    std::thread                                             m_send_data_thread;
+    EnetSendQueue                                           m_send_queue;
 
 private:
-    std::list<bool>                                         m_event_list;
-    std::mutex                                              m_event_mutex;
-    std::condition_variable                                 m_event_condition;
-    std::thread                                             m_event_thread;
+    std::vector<EnetFecEncoder>                             m_fec_encoders;
+    std::vector<EnetFecDecoder>                             m_fec_decoders;
 
 private:
-    std::list<bool>                                         m_callback_list;
-    std::mutex                                              m_callback_mutex;
-    std::condition_variable                                 m_callback_condition;
-    std::thread                                             m_callback_thread;
+    EnetServiceLoop                                       * m_service_loop;
+    EnetServiceLoop                                       * m_private_loop;
+    std::atomic<bool>                                       m_scheduled;
+
+private:
+    std::list<bool>                                         m_event_list;
+    std::mutex                                              m_event_mutex;
 };
 
 
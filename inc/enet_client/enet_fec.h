@@ -0,0 +1,110 @@
+/********************************************************
+ * Description : enet client forward error correction
+ * Author      : yanrk
+ * Email       : yanrkchina@163.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * Copyright(C): 2024
+ ********************************************************/
+
+#ifndef ENET_FEC_H
+#define ENET_FEC_H
+
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*
+ * every message on a channel with forward error correction starts with a
+ * header naming its group, once a group of unreliable messages is complete
+ * a parity message carries the xor of the length prefixed messages, from
+ * which the receiver rebuilds any single lost message of the group without
+ * waiting a round trip for a resend; reliable messages on such a channel
+ * carry the header too but are left out of the groups
+ *
+ * header: group (16 bits, big endian), index, kind
+ *   kind 0: a message outside of any group
+ *   kind 1: message number index of the group
+ *   kind 2: parity of the first index messages of the group
+ */
+class EnetFecEncoder
+{
+public:
+    static const uint32_t header_size = 4;
+    static const uint32_t max_group_size = 32;
+
+public:
+    EnetFecEncoder();
+
+public:
+    void init(uint32_t group_size);
+    void reset();
+    bool enabled() const;
+    bool pending() const;
+    uint32_t open_time() const;
+
+public:
+    void write(uint8_t * header, bool protect) const; /* the header of the next message, which belongs to the open group if protect */
+    bool add(const void * data, uint32_t size, uint32_t now); /* takes a protected message once it is sent, returns true once the group is complete */
+    const std::vector<uint8_t> & finish(); /* the parity message (header included) of the open group, which is closed */
+
+private:
+    uint32_t                                                m_group_size;
+    uint16_t                                                m_group;
+    uint32_t                                                m_count;
+    uint32_t                                                m_open_time;
+    std::vector<uint8_t>                                    m_parity;
+};
+
+class EnetFecDecoder
+{
+public:
+    EnetFecDecoder();
+
+public:
+    void init(bool enabled);
+    void reset();
+    bool enabled() const;
+
+public:
+    /*
+     * takes a message of the channel, payload is set to the message without
+     * its header, or to nullptr for a parity message and for a message that
+     * is not to be delivered (a late copy of a rebuilt message, or one of a
+     * group that has left the window); returns false if the message is
+     * malformed
+     */
+    bool receive(const uint8_t * data, uint32_t size, const uint8_t *& payload, uint32_t & payload_size);
+
+    /* returns true if the last received message let a lost message be rebuilt */
+    bool recover(const uint8_t *& data, uint32_t & size) const;
+
+private:
+    struct Group
+    {
+        bool                                                used;
+        bool                                                done;
+        bool                                                parity;
+        uint16_t                                            id;
+        uint32_t                                            count;
+        uint32_t                                            received;
+        std::vector<uint8_t>                                sum;
+    };
+
+private:
+    Group * group(uint16_t id); /* nullptr for a group older than the window */
+    void rebuild(Group & group);
+
+private:
+    static const uint32_t                                   s_group_window = 4;
+
+private:
+    bool                                                    m_enabled;
+    Group                                                   m_groups[s_group_window];
+    std::vector<uint8_t>                                    m_recovered;
+    bool                                                    m_has_recovered;
+};
+
+
+#endif // ENET_FEC_H
@@ -0,0 +1,123 @@
+/********************************************************
+ * Description : enet client send queue
+ * Author      : yanrk
+ * Email       : yanrkchina@163.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * Copyright(C): 2024
+ ********************************************************/
+
+#ifndef ENET_SEND_QUEUE_H
+#define ENET_SEND_QUEUE_H
+
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+extern "C"
+{
+    #include "enet.h"
+}
+
+#include "enet_client.h"
+
+class EnetSendQueue;
+
+struct EnetSendBuffer
+{
+    EnetSendQueue                                         * queue;
+    uint8_t                                               * data;
+    uint32_t                                                size;
+    uint32_t                                                capacity;
+    bool                                                    pooled;
+    uint8_t                                                 channel;
+    enet_uint32                                             flags;
+    const void                                            * external_data;
+    EnetReleaseCallback                                     release;
+    void                                                  * context;
+};
+
+/*
+ * bounded lock-free queue (dmitry vyukov's sequence per cell design),
+ * any number of producers and consumers, capacity is a power of two
+ */
+class EnetBoundedQueue
+{
+public:
+    EnetBoundedQueue();
+    ~EnetBoundedQueue();
+
+public:
+    bool init(uint32_t capacity);
+    void exit();
+
+public:
+    bool push(EnetSendBuffer * buffer);
+    bool pop(EnetSendBuffer *& buffer);
+
+private:
+    EnetBoundedQueue(const EnetBoundedQueue &) = delete;
+    EnetBoundedQueue & operator = (const EnetBoundedQueue &) = delete;
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t>                                 sequence;
+        EnetSendBuffer                                    * buffer;
+    };
+
+private:
+    Cell                                                  * m_cells;
+    size_t                                                  m_mask;
+    char                                                    m_enqueue_padding[64];
+    std::atomic<size_t>                                     m_enqueue_pos;
+    char                                                    m_dequeue_padding[64];
+    std::atomic<size_t>                                     m_dequeue_pos;
+};
+
+/*
+ * producers copy a message into a pooled buffer and queue it, the service
+ * thread turns the buffer into the payload of an enet packet without
+ * copying it again, and the buffer returns to the pool once enet frees
+ * the packet, so a steady stream of sends costs one copy and no malloc;
+ * a buffer may also borrow caller memory, which is handed back through
+ * its release callback instead of being copied at all
+ */
+class EnetSendQueue
+{
+public:
+    EnetSendQueue();
+    ~EnetSendQueue();
+
+public:
+    bool init(uint32_t capacity, uint32_t buffer_size);
+    void exit();
+
+public:
+    bool push(const void * data, uint32_t size, uint8_t channel, enet_uint32 flags);
+    bool push(const void * data, uint32_t size, uint8_t channel, enet_uint32 flags, EnetReleaseCallback release_callback, void * context);
+    EnetSendBuffer * pop();
+    ENetPacket * create_packet(ENetHost * host, EnetSendBuffer * buffer);
+    void release(EnetSendBuffer * buffer);
+    void clear();
+
+private:
+    EnetSendBuffer * acquire();
+    bool reserve(EnetSendBuffer * buffer, uint32_t size);
+    static void free_packet(ENetPacket * packet);
+
+private:
+    EnetSendQueue(const EnetSendQueue &) = delete;
+    EnetSendQueue & operator = (const EnetSendQueue &) = delete;
+
+private:
+    EnetSendBuffer                                        * m_buffers;
+    uint32_t                                                m_buffer_count;
+    uint32_t                                                m_buffer_size;
+    EnetBoundedQueue                                        m_free_queue;
+    EnetBoundedQueue                                        m_send_queue;
+};
+
+
+#endif // ENET_SEND_QUEUE_H
@@ -0,0 +1,133 @@
+/********************************************************
+ * Description : enet client service loop
+ * Author      : yanrk
+ * Email       : yanrkchina@163.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * Copyright(C): 2024
+ ********************************************************/
+
+#ifndef ENET_SERVICE_LOOP_H
+#define ENET_SERVICE_LOOP_H
+
+
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <unordered_map>
+
+extern "C"
+{
+    #include "enet.h"
+}
+
+class EnetClientImpl;
+
+/*
+ * one thread servicing the hosts of many enet clients: their sockets and a
+ * wakeup fd sit in one socket waiter (epoll on linux), a client is serviced
+ * when its socket is readable, when it is scheduled (connect, close, queued
+ * messages) and when the deadline it returned from its last service passes;
+ * clients are serviced with the client mutex held, so sink callbacks may
+ * connect, close or send, but adding or removing a client of the same loop
+ * would lock it again on the loop thread: EnetClient refuses to init or exit
+ * such a client there
+ */
+class EnetServiceLoop
+{
+public:
+    static const uint32_t infinite_timeout = 0xFFFFFFFF;
+
+public:
+    EnetServiceLoop();
+    ~EnetServiceLoop();
+
+public:
+    bool init();
+    void exit();
+
+public:
+    bool add_client(EnetClientImpl * client, ENetSocket socket);
+    void remove_client(EnetClientImpl * client);
+    void schedule_client(EnetClientImpl * client);
+    size_t client_count() const;
+    bool is_loop_thread() const; /* true on the thread of this loop, where the sink is called back */
+
+private:
+    void run();
+    void service_client(EnetClientImpl * client);
+    uint32_t next_timeout();
+
+private:
+    bool create_wakeup();
+    void destroy_wakeup();
+    void notify_wakeup();
+    void clear_wakeup();
+
+private:
+    EnetServiceLoop(const EnetServiceLoop &) = delete;
+    EnetServiceLoop & operator = (const EnetServiceLoop &) = delete;
+
+private:
+    struct ClientEntry
+    {
+        ENetSocket                                          socket;
+        uint64_t                                            deadline;
+    };
+
+private:
+    std::atomic<bool>                                       m_running;
+    ENetSocketWaiter                                      * m_waiter;
+    std::thread                                             m_thread;
+
+private:
+    int                                                     m_wakeup_read_fd;
+    int                                                     m_wakeup_write_fd;
+    std::atomic<bool>                                       m_wakeup_pending;
+
+private:
+    std::unordered_map<EnetClientImpl *, ClientEntry>       m_clients;
+    std::set<std::pair<uint64_t, EnetClientImpl *>>         m_deadlines;
+    std::atomic<size_t>                                     m_client_count;
+    std::mutex                                              m_client_mutex;
+
+private:
+    std::vector<EnetClientImpl *>                           m_schedule_list;
+    std::mutex                                              m_schedule_mutex;
+
+private:
+    static thread_local const EnetServiceLoop             * s_thread_loop; /* the loop whose thread this is */
+};
+
+/*
+ * the loops of an EnetClientService, each client is bound to the loop with
+ * the fewest clients when it is initialized
+ */
+class EnetClientServiceImpl
+{
+public:
+    EnetClientServiceImpl();
+    ~EnetClientServiceImpl();
+
+public:
+    bool init(uint32_t thread_count);
+    void exit();
+
+public:
+    EnetServiceLoop * acquire_loop();
+    bool is_loop_thread() const; /* exit() joins the loop threads, it cannot be called on one of them */
+
+private:
+    EnetClientServiceImpl(const EnetClientServiceImpl &) = delete;
+    EnetClientServiceImpl & operator = (const EnetClientServiceImpl &) = delete;
+
+private:
+    std::vector<EnetServiceLoop *>                          m_loops;
+};
+
+
+#endif // ENET_SERVICE_LOOP_H
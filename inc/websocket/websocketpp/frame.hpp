@@ -29,8 +29,21 @@
 #define WEBSOCKETPP_FRAME_HPP
 
 #include <algorithm>
+#include <cstring>
 #include <string>
 
+#if (defined(__aarch64__) || (defined(__ARM_NEON) && !defined(_MSC_VER))) && !defined(__ARM_BIG_ENDIAN)
+    #define _WEBSOCKETPP_NEON_MASKING_
+    #include <arm_neon.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define _WEBSOCKETPP_SSE2_MASKING_
+    #include <emmintrin.h>
+    #if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+        #define _WEBSOCKETPP_AVX2_MASKING_
+        #include <immintrin.h>
+    #endif
+#endif
+
 #include <websocketpp/common/system_error.hpp>
 #include <websocketpp/common/network.hpp>
 
@@ -678,6 +691,90 @@ void byte_mask(iter_type b, iter_type e, masking_key_type const & key,
     byte_mask(b,e,b,key,key_offset);
 }
 
+#if defined(_WEBSOCKETPP_AVX2_MASKING_)
+/// AVX2 kernel of vector_mask, key is the masking key as a word
+__attribute__((target("avx2")))
+inline size_t avx2_mask(uint8_t const * input, uint8_t * output, size_t length,
+    uint32_t key)
+{
+    __m256i k = _mm256_set1_epi32(static_cast<int>(key));
+    size_t n = length & ~static_cast<size_t>(31);
+
+    for (size_t i = 0; i < n; i += 32) {
+        __m256i v = _mm256_loadu_si256(
+            reinterpret_cast<__m256i const *>(input + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i),
+            _mm256_xor_si256(v, k));
+    }
+
+    return n;
+}
+
+inline bool has_avx2() {
+    static bool const avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+#endif
+
+/// Vector mask/unmask
+/**
+ * Masks or unmasks the leading part of a buffer in vector register sized
+ * blocks, with AVX2 when the cpu has it (checked once at run time), SSE2 on
+ * other x86 cpus and NEON on little endian arm. The number of bytes done is
+ * a multiple of 16 and therefore of the word size, so the caller carries on
+ * with the rest using the same key phase. Nothing is done on other
+ * architectures.
+ *
+ * input and output may be the same buffer and need not be aligned.
+ *
+ * @param input buffer to mask or unmask
+ *
+ * @param output buffer to store the output
+ *
+ * @param length length of the buffers
+ *
+ * @param key Masking key for the first byte of input
+ *
+ * @return number of bytes masked
+ */
+inline size_t vector_mask(uint8_t const * input, uint8_t * output,
+    size_t length, masking_key_type const & key)
+{
+    if (length < 16) {
+        return 0;
+    }
+
+    // the key word is broadcast from a register, on these little endian
+    // targets its bytes then lie in the key order in every lane
+    size_t done = 0;
+
+#if defined(_WEBSOCKETPP_AVX2_MASKING_)
+    if (length >= 64 && has_avx2()) {
+        done = avx2_mask(input, output, length, key.i);
+    }
+#endif
+
+#if defined(_WEBSOCKETPP_NEON_MASKING_)
+    uint8x16_t k = vreinterpretq_u8_u32(vdupq_n_u32(key.i));
+    for (; done + 16 <= length; done += 16) {
+        vst1q_u8(output + done, veorq_u8(vld1q_u8(input + done), k));
+    }
+#elif defined(_WEBSOCKETPP_SSE2_MASKING_)
+    __m128i k = _mm_set1_epi32(static_cast<int>(key.i));
+    for (; done + 16 <= length; done += 16) {
+        __m128i v = _mm_loadu_si128(
+            reinterpret_cast<__m128i const *>(input + done));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output + done),
+            _mm_xor_si128(v, k));
+    }
+#else
+    (void)input;
+    (void)output;
+#endif
+
+    return done;
+}
+
 /// Exact word aligned mask/unmask
 /**
  * Balanced combination of byte by byte and circular word by word masking.
@@ -685,8 +782,9 @@ void byte_mask(iter_type b, iter_type e, masking_key_type const & key,
  * word_mask_circ but works with exact sized buffers.
  *
  * Buffer based word by word masking and unmasking for WebSocket payloads.
- * Masking is done in word by word chunks with the remainder not divisible by
- * the word size done byte by byte.
+ * Masking is done in vector sized chunks where vector_mask can, then in word
+ * by word chunks with the remainder not divisible by the word size done byte
+ * by byte.
  *
  * input and output must both be at least length bytes. Exactly length bytes
  * will be written.
@@ -702,16 +800,17 @@ void byte_mask(iter_type b, iter_type e, masking_key_type const & key,
 inline void word_mask_exact(uint8_t* input, uint8_t* output, size_t length,
     const masking_key_type& key)
 {
+    size_t done = vector_mask(input, output, length, key);
     size_t prepared_key = prepare_masking_key(key);
-    size_t n = length/sizeof(size_t);
-    size_t* input_word = reinterpret_cast<size_t*>(input);
-    size_t* output_word = reinterpret_cast<size_t*>(output);
+    size_t n = (length-done)/sizeof(size_t);
+    size_t* input_word = reinterpret_cast<size_t*>(input+done);
+    size_t* output_word = reinterpret_cast<size_t*>(output+done);
 
     for (size_t i = 0; i < n; i++) {
         output_word[i] = input_word[i] ^ prepared_key;
     }
 
-    for (size_t i = n*sizeof(size_t); i < length; i++) {
+    for (size_t i = done+n*sizeof(size_t); i < length; i++) {
         output[i] = input[i] ^ key.c[i%4];
     }
 }
@@ -768,6 +867,14 @@ inline void word_mask_exact(uint8_t* data, size_t length, const
 inline size_t word_mask_circ(uint8_t * input, uint8_t * output, size_t length,
     size_t prepared_key)
 {
+    // mask vector by vector, which leaves the key phase as it was
+    masking_key_type key;
+    std::memcpy(key.c, &prepared_key, sizeof(key.c));
+    size_t done = vector_mask(input, output, length, key);
+    input += done;
+    output += done;
+    length -= done;
+
     size_t n = length / sizeof(size_t); // whole words
     size_t l = length - (n * sizeof(size_t)); // remaining bytes
     size_t * input_word = reinterpret_cast<size_t *>(input);
@@ -833,7 +940,9 @@ inline size_t byte_mask_circ(uint8_t * input, uint8_t * output, size_t length,
     uint32_converter key;
     key.i = prepared_key;
 
-    for (size_t i = 0; i < length; ++i) {
+    size_t done = vector_mask(input, output, length, key);
+
+    for (size_t i = done; i < length; ++i) {
         output[i] = input[i] ^ key.c[i % 4];
     }
 
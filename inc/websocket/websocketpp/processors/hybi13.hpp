@@ -802,7 +802,6 @@ protected:
         if (frame::get_masked(m_basic_header)) {
             m_current_msg->prepared_key = frame::byte_mask_circ(
                 buf, len, m_current_msg->prepared_key);
-            // TODO: SIMD masking
         }
 
         std::string & out = m_current_msg->msg_ptr->get_raw_payload();
@@ -961,8 +960,12 @@ protected:
     void masked_copy (std::string const & i, std::string & o,
         frame::masking_key_type key) const
     {
-        frame::byte_mask(i.begin(),i.end(),o.begin(),key);
-        // TODO: SIMD masking
+        if (i.empty()) {
+            return;
+        }
+        frame::word_mask_exact(
+            reinterpret_cast<uint8_t *>(const_cast<char *>(i.data())),
+            reinterpret_cast<uint8_t *>(&o[0]),i.size(),key);
     }
 
     /// Generic prepare control frame with opcode and payload.
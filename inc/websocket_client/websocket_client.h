@@ -11,9 +11,16 @@
 #define WEBSOCKET_CLIENT_H
 
 
+#include <string>
 #include <cstdint>
 #include "base.h"
 
+/*
+ * the sink is called back on the threads of its client, or on the io threads
+ * of the service the client is bound to; exit() (and so init() again and the
+ * destructor) of the client must not be called from a callback, it waits for
+ * those threads and is refused there
+ */
 struct GOOFER_API WebsocketClientSink
 {
     virtual ~WebsocketClientSink();
@@ -23,6 +30,45 @@ struct GOOFER_API WebsocketClientSink
     virtual void on_websocket_recv(const void * data, uint32_t size, bool binary) = 0;
 };
 
+class WebsocketClientServiceImpl;
+
+/*
+ * io threads shared by many websocket clients, the connections of all its
+ * clients run on one asio io service instead of every client running a
+ * work, an event and a callback thread of its own; exit every client bound
+ * to the service before exiting it, and no client bound to it from one of
+ * its io threads, where a callback would wait on the thread it runs on
+ */
+class GOOFER_API WebsocketClientService
+{
+public:
+    WebsocketClientService();
+    ~WebsocketClientService();
+
+public:
+    bool init(uint32_t thread_count);
+    void exit();
+
+private:
+    WebsocketClientService(const WebsocketClientService &) = delete;
+    WebsocketClientService(WebsocketClientService &&) = delete;
+    WebsocketClientService & operator = (const WebsocketClientService &) = delete;
+    WebsocketClientService & operator = (WebsocketClientService &&) = delete;
+
+private:
+    friend class WebsocketClient;
+
+private:
+    WebsocketClientServiceImpl    * m_impl;
+};
+
+struct GOOFER_API WebsocketClientOptions
+{
+    WebsocketClientOptions();
+
+    WebsocketClientService    * service;            /* shared io threads, nullptr runs the threads of this client alone */
+};
+
 class WebsocketSessionBase;
 
 class GOOFER_API WebsocketClient
@@ -34,12 +80,15 @@ public:
 public:
     bool init(WebsocketClientSink * sink, const char * host, uint16_t port, bool secure);
     bool init(WebsocketClientSink * sink, const char * url);
+    bool init(WebsocketClientSink * sink, const char * host, uint16_t port, bool secure, const WebsocketClientOptions & options);
+    bool init(WebsocketClientSink * sink, const char * url, const WebsocketClientOptions & options);
     void exit();
 
 public:
     void connect();
     void close();
     bool send_message(const void * data, uint32_t size, bool binary);
+    bool send_message(std::string && data, bool binary); /* masks the buffer of data in place and sends it without a copy, takes it only when returns true */
     bool is_connected() const;
 
 private:
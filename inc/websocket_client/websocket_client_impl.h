@@ -13,8 +13,11 @@
 
 #include <list>
 #include <string>
+#include <vector>
+#include <memory>
 #include <thread>
 #include <mutex>
+#include <atomic>
 #include <condition_variable>
 
 #define ASIO_STANDALONE
@@ -31,8 +34,36 @@
 #include "websocketpp/client.hpp"
 
 #include "websocket_client.h"
+#include "websocket_message_pool.h"
 #include "base.h"
 
+/*
+ * the io service of a WebsocketClientService, run by all of its threads
+ */
+class WebsocketClientServiceImpl
+{
+public:
+    WebsocketClientServiceImpl();
+    ~WebsocketClientServiceImpl();
+
+public:
+    bool init(uint32_t thread_count);
+    void exit();
+
+public:
+    asio::io_service & io_service();
+    bool is_io_thread(); /* exit() joins the io threads, it cannot be called on one of them */
+
+private:
+    WebsocketClientServiceImpl(const WebsocketClientServiceImpl &) = delete;
+    WebsocketClientServiceImpl & operator = (const WebsocketClientServiceImpl &) = delete;
+
+private:
+    asio::io_service                                        m_io_service;
+    std::unique_ptr<asio::io_service::work>                 m_io_work;
+    std::vector<std::thread>                                m_io_threads;
+};
+
 class WebsocketSessionBase
 {
 public:
@@ -40,14 +71,19 @@ public:
     virtual ~WebsocketSessionBase();
 
 public:
-    virtual bool init(WebsocketClientSink * sink, const std::string & url) = 0;
+    virtual bool init(WebsocketClientSink * sink, const std::string & url, asio::io_service * io_service) = 0; /* io_service nullptr for threads of the session's own */
     virtual void exit() = 0;
 
 public:
     virtual void connect() = 0;
     virtual void close() = 0;
     virtual bool send_message(const void * data, uint32_t size, bool binary) = 0;
+    virtual bool send_message(std::string && data, bool binary) = 0;
     virtual bool is_connected() const = 0;
+    virtual bool is_callback_thread() const = 0; /* true on a thread that calls the sink back, which exit() cannot wait for */
+
+protected:
+    static thread_local const WebsocketSessionBase        * s_thread_session; /* the session whose own thread this is */
 };
 
 template <typename client_type>
@@ -58,20 +94,28 @@ public:
     virtual ~WebsocketSession();
 
 public:
-    virtual bool init(WebsocketClientSink * sink, const std::string & url) override;
+    virtual bool init(WebsocketClientSink * sink, const std::string & url, asio::io_service * io_service) override;
     virtual void exit() override;
 
 public:
     virtual void connect() override;
     virtual void close() override;
     virtual bool send_message(const void * data, uint32_t size, bool binary) override;
+    virtual bool send_message(std::string && data, bool binary) override;
     virtual bool is_connected() const override;
+    virtual bool is_callback_thread() const override;
 
 protected:
     websocketpp::client<client_type> & get_client();
-    void set_handle(websocketpp::connection_hdl handle);
     void on_error(const char * action, const char * message);
 
+private:
+    websocketpp::connection_hdl get_handle();
+    bool is_current(websocketpp::connection_hdl handle);
+    bool release_handle(websocketpp::connection_hdl & handle);
+    void on_open(websocketpp::connection_hdl handle);
+    void on_end(websocketpp::connection_hdl handle);
+
 private:
     void on_connect();
     void on_close();
@@ -82,20 +126,36 @@ private:
 
 private:
     void real_connect();
-    void real_close();
+    void real_close(websocketpp::connection_hdl handle);
+    bool real_send(typename websocketpp::client<client_type>::message_ptr message, const websocketpp::frame::masking_key_type & key);
+
+private:
+    template <typename task_type>
+    void post_task(task_type task);
+    void wait_tasks();
+    void wait_connections();
 
 private:
     virtual void set_specific_handler() = 0;
 
 private:
-    bool                                                    m_running;
-    bool                                                    m_working;
+    std::atomic<bool>                                       m_running;
+    std::atomic<bool>                                       m_working;
     WebsocketClientSink                                   * m_sink;
     std::string                                             m_url;
     websocketpp::client<client_type>                        m_client;
     websocketpp::connection_hdl                             m_handle;
+    std::mutex                                              m_handle_mutex;
+    std::list<websocketpp::connection_hdl>                  m_connections;
+    typename client_type::rng_type                          m_rng;
+    typename client_type::con_msg_manager_type              m_message_pool;
     std::thread                                             m_work_thread;
 
+private:
+    asio::io_service                                      * m_io_service;
+    std::unique_ptr<asio::io_service::strand>               m_strand;
+    std::atomic<uint32_t>                                   m_pending_tasks;
+
 private:
     std::list<bool>                                         m_event_list;
     std::mutex                                              m_event_mutex;
@@ -117,7 +177,14 @@ WebsocketSession<client_type>::WebsocketSession()
     , m_url()
     , m_client()
     , m_handle()
+    , m_handle_mutex()
+    , m_connections()
+    , m_rng()
+    , m_message_pool()
     , m_work_thread()
+    , m_io_service(nullptr)
+    , m_strand()
+    , m_pending_tasks(0)
     , m_event_list()
     , m_event_mutex()
     , m_event_condition()
@@ -129,7 +196,6 @@ WebsocketSession<client_type>::WebsocketSession()
 {
     m_client.clear_access_channels(websocketpp::log::alevel::all);
     m_client.clear_error_channels(websocketpp::log::elevel::all);
-    m_client.init_asio();
 }
 
 template <typename client_type>
@@ -139,38 +205,48 @@ WebsocketSession<client_type>::~WebsocketSession()
 }
 
 template <typename client_type>
-bool WebsocketSession<client_type>::init(WebsocketClientSink * sink, const std::string & url)
+bool WebsocketSession<client_type>::init(WebsocketClientSink * sink, const std::string & url, asio::io_service * io_service)
 {
     exit();
 
     m_sink = sink;
     m_url = url;
 
+    /* the endpoint takes its io service once, a session is initialized once */
+    websocketpp::lib::error_code err;
+    if (nullptr != io_service)
+    {
+        m_client.init_asio(io_service, err);
+    }
+    else
+    {
+        m_client.init_asio(err);
+    }
+    if (err)
+    {
+        RUN_LOG_ERR("websocket client init failure while init asio failed (%s)", err.message().c_str());
+        return false;
+    }
+    m_io_service = io_service;
+
     m_client.set_close_handler([this](websocketpp::connection_hdl handle){
-        set_handle(handle);
-        m_working = false;
-        on_close();
+        on_end(handle);
     });
 
     m_client.set_fail_handler([this](websocketpp::connection_hdl handle){
-        set_handle(handle);
-        m_working = false;
-        on_close();
+        on_end(handle);
     });
 
     m_client.set_http_handler([this](websocketpp::connection_hdl handle){
-        set_handle(handle);
+
     });
 
     m_client.set_interrupt_handler([this](websocketpp::connection_hdl handle){
-        set_handle(handle);
-        m_working = false;
-        on_close();
+        on_end(handle);
     });
 
-    m_client.set_message_handler([this](websocketpp::connection_hdl handle, websocketpp::config::asio_client::message_type::ptr message){
-        set_handle(handle);
-        if (nullptr != message)
+    m_client.set_message_handler([this](websocketpp::connection_hdl handle, typename client_type::message_type::ptr message){
+        if (nullptr != message && is_current(handle))
         {
             const std::string & data = message->get_payload();
             bool binary = websocketpp::frame::opcode::BINARY == message->get_opcode();
@@ -182,25 +258,22 @@ bool WebsocketSession<client_type>::init(WebsocketClientSink * sink, const std::
     });
 
     m_client.set_open_handler([this](websocketpp::connection_hdl handle){
-        set_handle(handle);
-        m_working = true;
-        on_connect();
+        on_open(handle);
     });
 
     m_client.set_pong_handler([this](websocketpp::connection_hdl handle, std::string message){
-        set_handle(handle);
+
     });
 
     m_client.set_tcp_post_init_handler([this](websocketpp::connection_hdl handle){
-        set_handle(handle);
+
     });
 
     m_client.set_tcp_pre_init_handler([this](websocketpp::connection_hdl handle){
-        set_handle(handle);
+
     });
 
     m_client.set_validate_handler([this](websocketpp::connection_hdl handle){
-        set_handle(handle);
         return true;
     });
 
@@ -208,7 +281,15 @@ bool WebsocketSession<client_type>::init(WebsocketClientSink * sink, const std::
 
     m_running = true;
 
+    /* with a shared io service the events and callbacks run as tasks on a strand of it, the session has no thread */
+    if (nullptr != m_io_service)
+    {
+        m_strand.reset(new asio::io_service::strand(*m_io_service));
+        return true;
+    }
+
     m_event_thread = std::thread([this]{
+        s_thread_session = this;
         while (m_running)
         {
             std::list<bool> event_list;
@@ -237,6 +318,7 @@ bool WebsocketSession<client_type>::init(WebsocketClientSink * sink, const std::
     });
 
     m_callback_thread = std::thread([this]{
+        s_thread_session = this;
         while (m_running)
         {
             std::list<bool> callback_list;
@@ -297,6 +379,12 @@ void WebsocketSession<client_type>::exit()
     {
         m_running = false;
 
+        /* a task already running may still open a connection, so it is waited for before closing */
+        if (nullptr != m_io_service)
+        {
+            wait_tasks();
+        }
+
         do_close();
 
         if (m_event_thread.joinable())
@@ -316,8 +404,17 @@ void WebsocketSession<client_type>::exit()
             m_work_thread.join();
         }
 
+        /* the shared io service runs on, the handlers of this session must be done with it */
+        if (nullptr != m_io_service)
+        {
+            wait_connections();
+            wait_tasks();
+            m_strand.reset();
+        }
+
         m_event_list.clear();
         m_callback_list.clear();
+        m_connections.clear();
 
         m_working = false;
     }
@@ -326,6 +423,14 @@ void WebsocketSession<client_type>::exit()
 template <typename client_type>
 void WebsocketSession<client_type>::connect()
 {
+    if (nullptr != m_strand)
+    {
+        post_task([this]{
+            do_connect();
+        });
+        return;
+    }
+
     {
         std::lock_guard<std::mutex> locker(m_event_mutex);
         m_event_list.push_back(true);
@@ -336,6 +441,14 @@ void WebsocketSession<client_type>::connect()
 template <typename client_type>
 void WebsocketSession<client_type>::close()
 {
+    if (nullptr != m_strand)
+    {
+        post_task([this]{
+            do_close();
+        });
+        return;
+    }
+
     {
         std::lock_guard<std::mutex> locker(m_event_mutex);
         m_event_list.push_back(false);
@@ -346,6 +459,17 @@ void WebsocketSession<client_type>::close()
 template <typename client_type>
 void WebsocketSession<client_type>::on_connect()
 {
+    if (nullptr != m_strand)
+    {
+        post_task([this]{
+            if (nullptr != m_sink)
+            {
+                m_sink->on_websocket_connect();
+            }
+        });
+        return;
+    }
+
     {
         std::lock_guard<std::mutex> locker(m_callback_mutex);
         m_callback_list.push_back(true);
@@ -356,6 +480,17 @@ void WebsocketSession<client_type>::on_connect()
 template <typename client_type>
 void WebsocketSession<client_type>::on_close()
 {
+    if (nullptr != m_strand)
+    {
+        post_task([this]{
+            if (nullptr != m_sink)
+            {
+                m_sink->on_websocket_close();
+            }
+        });
+        return;
+    }
+
     {
         std::lock_guard<std::mutex> locker(m_callback_mutex);
         m_callback_list.push_back(false);
@@ -372,14 +507,57 @@ void WebsocketSession<client_type>::on_error(const char * action, const char * m
     }
 }
 
+template <typename client_type>
+void WebsocketSession<client_type>::on_open(websocketpp::connection_hdl handle)
+{
+    bool current = false;
+
+    {
+        std::lock_guard<std::mutex> locker(m_handle_mutex);
+        if (!m_handle.owner_before(handle) && !handle.owner_before(m_handle))
+        {
+            m_working = true;
+            current = true;
+        }
+    }
+
+    if (current)
+    {
+        on_connect();
+    }
+    else
+    {
+        /* given up on while connecting, by close or by a newer connect */
+        websocketpp::lib::error_code err;
+        m_client.close(handle, websocketpp::close::status::going_away, "", err);
+    }
+}
+
+template <typename client_type>
+void WebsocketSession<client_type>::on_end(websocketpp::connection_hdl handle)
+{
+    {
+        std::lock_guard<std::mutex> locker(m_handle_mutex);
+        if (m_handle.owner_before(handle) || handle.owner_before(m_handle))
+        {
+            return;
+        }
+        m_handle.reset();
+        m_working = false;
+    }
+
+    on_close();
+}
+
 template <typename client_type>
 void WebsocketSession<client_type>::do_connect()
 {
     if (m_running)
     {
-        if (is_connected())
+        websocketpp::connection_hdl handle;
+        if (release_handle(handle))
         {
-            real_close();
+            real_close(handle);
 
             if (m_work_thread.joinable())
             {
@@ -396,10 +574,18 @@ void WebsocketSession<client_type>::do_connect()
             }
         }
 
-        m_work_thread = std::thread([this]{
+        if (nullptr != m_io_service)
+        {
             real_connect();
-            m_client.run();
-        });
+        }
+        else
+        {
+            m_work_thread = std::thread([this]{
+                s_thread_session = this;
+                real_connect();
+                m_client.run();
+            });
+        }
     }
     else
     {
@@ -410,9 +596,10 @@ void WebsocketSession<client_type>::do_connect()
 template <typename client_type>
 void WebsocketSession<client_type>::do_close()
 {
-    if (is_connected())
+    websocketpp::connection_hdl handle;
+    if (release_handle(handle))
     {
-        real_close();
+        real_close(handle);
 
         if (m_work_thread.joinable())
         {
@@ -425,6 +612,11 @@ void WebsocketSession<client_type>::do_close()
     m_working = false;
 }
 
+/*
+ * the frame is built here rather than by websocketpp, which copies the
+ * payload into a message and then again, masked, into a second one: the
+ * payload is masked while it is copied, or in place when it is moved in
+ */
 template <typename client_type>
 bool WebsocketSession<client_type>::send_message(const void * data, uint32_t size, bool binary)
 {
@@ -433,11 +625,51 @@ bool WebsocketSession<client_type>::send_message(const void * data, uint32_t siz
         return false;
     }
 
-    websocketpp::lib::error_code err;
-    m_client.send(m_handle, data, size, binary ? websocketpp::frame::opcode::BINARY : websocketpp::frame::opcode::TEXT, err);
-    if (err)
+    websocketpp::utf8_validator::validator validator;
+    if (!binary && !(validator.decode(reinterpret_cast<const uint8_t *>(data), reinterpret_cast<const uint8_t *>(data) + size) && validator.complete()))
     {
-        on_error("send", err.message().c_str());
+        on_error("send", websocketpp::processor::error::make_error_code(websocketpp::processor::error::invalid_payload).message().c_str());
+        return false;
+    }
+
+    typename websocketpp::client<client_type>::message_ptr message = m_message_pool.get_message(binary ? websocketpp::frame::opcode::BINARY : websocketpp::frame::opcode::TEXT, size);
+    std::string & payload = message->get_raw_payload();
+    payload.resize(size);
+
+    websocketpp::frame::masking_key_type key;
+    key.i = m_rng();
+    websocketpp::frame::word_mask_exact(reinterpret_cast<uint8_t *>(const_cast<void *>(data)), reinterpret_cast<uint8_t *>(&payload[0]), size, key);
+
+    return real_send(message, key);
+}
+
+template <typename client_type>
+bool WebsocketSession<client_type>::send_message(std::string && data, bool binary)
+{
+    if (!m_running || !m_working || data.empty())
+    {
+        return false;
+    }
+
+    if (!binary && !websocketpp::utf8_validator::validate(data))
+    {
+        on_error("send", websocketpp::processor::error::make_error_code(websocketpp::processor::error::invalid_payload).message().c_str());
+        return false;
+    }
+
+    typename websocketpp::client<client_type>::message_ptr message = m_message_pool.get_message(binary ? websocketpp::frame::opcode::BINARY : websocketpp::frame::opcode::TEXT, 0);
+    std::string & payload = message->get_raw_payload();
+    payload.swap(data);
+
+    websocketpp::frame::masking_key_type key;
+    key.i = m_rng();
+    websocketpp::frame::word_mask_exact(reinterpret_cast<uint8_t *>(&payload[0]), payload.size(), key);
+
+    if (!real_send(message, key))
+    {
+        /* masking twice with the same key unmasks, the caller gets its data back */
+        websocketpp::frame::word_mask_exact(reinterpret_cast<uint8_t *>(&payload[0]), payload.size(), key);
+        payload.swap(data);
         return false;
     }
 
@@ -450,6 +682,17 @@ bool WebsocketSession<client_type>::is_connected() const
     return m_working;
 }
 
+/* every io thread of a shared io service may run the callbacks of this session, or tasks that another session waits for */
+template <typename client_type>
+bool WebsocketSession<client_type>::is_callback_thread() const
+{
+    if (nullptr != m_io_service)
+    {
+        return m_io_service->get_executor().running_in_this_thread();
+    }
+    return this == s_thread_session;
+}
+
 template <typename client_type>
 websocketpp::client<client_type> & WebsocketSession<client_type>::get_client()
 {
@@ -457,9 +700,29 @@ websocketpp::client<client_type> & WebsocketSession<client_type>::get_client()
 }
 
 template <typename client_type>
-void WebsocketSession<client_type>::set_handle(websocketpp::connection_hdl handle)
+websocketpp::connection_hdl WebsocketSession<client_type>::get_handle()
 {
-    m_handle = handle;
+    std::lock_guard<std::mutex> locker(m_handle_mutex);
+    return m_handle;
+}
+
+template <typename client_type>
+bool WebsocketSession<client_type>::is_current(websocketpp::connection_hdl handle)
+{
+    std::lock_guard<std::mutex> locker(m_handle_mutex);
+    return !m_handle.owner_before(handle) && !handle.owner_before(m_handle);
+}
+
+/* takes the handle of the current connection, whose handlers are ignored from now on, returns true if it was open */
+template <typename client_type>
+bool WebsocketSession<client_type>::release_handle(websocketpp::connection_hdl & handle)
+{
+    std::lock_guard<std::mutex> locker(m_handle_mutex);
+    bool working = m_working;
+    handle = m_handle;
+    m_handle.reset();
+    m_working = false;
+    return working;
 }
 
 template <typename client_type>
@@ -467,7 +730,7 @@ void WebsocketSession<client_type>::real_connect()
 {
     try
     {
-        if (m_client.stopped())
+        if (nullptr == m_io_service && m_client.stopped())
         {
             m_client.reset();
         }
@@ -481,6 +744,14 @@ void WebsocketSession<client_type>::real_connect()
         {
             if (conn)
             {
+                {
+                    std::lock_guard<std::mutex> locker(m_handle_mutex);
+                    m_handle = conn->get_handle();
+                }
+                m_connections.remove_if([](const websocketpp::connection_hdl & handle){
+                    return handle.expired();
+                });
+                m_connections.push_back(conn->get_handle());
                 m_client.connect(conn);
             }
             else
@@ -504,13 +775,16 @@ void WebsocketSession<client_type>::real_connect()
 }
 
 template <typename client_type>
-void WebsocketSession<client_type>::real_close()
+void WebsocketSession<client_type>::real_close(websocketpp::connection_hdl handle)
 {
     try
     {
         websocketpp::lib::error_code err;
-        m_client.close(m_handle, websocketpp::close::status::going_away, "", err);
-        m_client.stop();
+        m_client.close(handle, websocketpp::close::status::going_away, "", err);
+        if (nullptr == m_io_service)
+        {
+            m_client.stop();
+        }
     }
     catch (websocketpp::lib::error_code err)
     {
@@ -526,16 +800,126 @@ void WebsocketSession<client_type>::real_close()
     }
 }
 
-class WebsocketSessionPlain : public WebsocketSession<websocketpp::config::asio_client>
+template <typename client_type>
+bool WebsocketSession<client_type>::real_send(typename websocketpp::client<client_type>::message_ptr message, const websocketpp::frame::masking_key_type & key)
+{
+    std::string & payload = message->get_raw_payload();
+    websocketpp::frame::basic_header header(message->get_opcode(), payload.size(), true, true, false);
+    websocketpp::frame::extended_header extended_header(payload.size(), key.i);
+    message->set_header(websocketpp::frame::prepare_header(header, extended_header));
+    message->set_prepared(true);
+
+    websocketpp::lib::error_code err;
+    m_client.send(get_handle(), message, err);
+    if (err)
+    {
+        on_error("send", err.message().c_str());
+        return false;
+    }
+
+    return true;
+}
+
+template <typename client_type>
+template <typename task_type>
+void WebsocketSession<client_type>::post_task(task_type task)
+{
+    ++m_pending_tasks;
+    m_strand->post([this, task]{
+        if (m_running)
+        {
+            task();
+        }
+        --m_pending_tasks;
+    });
+}
+
+template <typename client_type>
+void WebsocketSession<client_type>::wait_tasks()
+{
+    while (0 != m_pending_tasks)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+/* a connection is freed once its last handler is done, which closing takes at most the handshake timeouts of websocketpp */
+template <typename client_type>
+void WebsocketSession<client_type>::wait_connections()
+{
+    for (std::list<websocketpp::connection_hdl>::const_iterator iter = m_connections.begin(); m_connections.end() != iter; ++iter)
+    {
+        while (!iter->expired())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+/*
+ * the websocketpp client configs with the messages of every frame sent or
+ * received taken from a WebsocketMessagePool instead of the heap
+ */
+struct WebsocketClientConfig : public websocketpp::config::asio_client
+{
+    typedef WebsocketClientConfig type;
+    typedef websocketpp::config::asio_client base;
+
+    typedef websocketpp::message_buffer::message<WebsocketMessagePool> message_type;
+    typedef WebsocketMessagePool<message_type> con_msg_manager_type;
+    typedef websocketpp::message_buffer::alloc::endpoint_msg_manager<con_msg_manager_type> endpoint_msg_manager_type;
+};
+
+struct WebsocketClientTlsConfig : public websocketpp::config::asio_tls_client
+{
+    typedef WebsocketClientTlsConfig type;
+    typedef websocketpp::config::asio_tls_client base;
+
+    typedef websocketpp::message_buffer::message<WebsocketMessagePool> message_type;
+    typedef WebsocketMessagePool<message_type> con_msg_manager_type;
+    typedef websocketpp::message_buffer::alloc::endpoint_msg_manager<con_msg_manager_type> endpoint_msg_manager_type;
+};
+
+class WebsocketSessionPlain : public WebsocketSession<WebsocketClientConfig>
 {
 private:
     virtual void set_specific_handler() override;
 };
 
-class WebsocketSessionSecure : public WebsocketSession<websocketpp::config::asio_tls_client>
+/*
+ * the tls session of the last handshake of a websocket client, offered to
+ * the server on the next connect so that a reconnect resumes it (session
+ * ticket or session id) instead of running a full handshake
+ */
+class WebsocketTlsSessionCache
 {
+public:
+    WebsocketTlsSessionCache();
+    ~WebsocketTlsSessionCache();
+
+public:
+    void store(SSL_SESSION * session); /* takes over the reference of session */
+    void offer(SSL * ssl) const;
+
+private:
+    WebsocketTlsSessionCache(const WebsocketTlsSessionCache &) = delete;
+    WebsocketTlsSessionCache & operator = (const WebsocketTlsSessionCache &) = delete;
+
+private:
+    SSL_SESSION                                           * m_session;
+    mutable std::mutex                                      m_mutex;
+};
+
+class WebsocketSessionSecure : public WebsocketSession<WebsocketClientTlsConfig>
+{
+public:
+    WebsocketSessionSecure();
+
 private:
     virtual void set_specific_handler() override;
+
+private:
+    std::shared_ptr<WebsocketTlsSessionCache>               m_tls_session_cache;
 };
 
 
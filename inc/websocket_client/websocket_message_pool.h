@@ -0,0 +1,296 @@
+/********************************************************
+ * Description : websocket client message pool
+ * Author      : yanrk
+ * Email       : yanrkchina@163.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * Copyright(C): 2024
+ ********************************************************/
+
+#ifndef WEBSOCKET_MESSAGE_POOL_H
+#define WEBSOCKET_MESSAGE_POOL_H
+
+
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "websocketpp/frame.hpp"
+
+/*
+ * fixed size blocks for the control blocks of pooled message pointers,
+ * a block of another size goes straight to the heap
+ */
+class WebsocketBlockCache
+{
+public:
+    WebsocketBlockCache();
+    ~WebsocketBlockCache();
+
+public:
+    void * allocate(size_t size);
+    void deallocate(void * block, size_t size);
+
+private:
+    WebsocketBlockCache(const WebsocketBlockCache &) = delete;
+    WebsocketBlockCache & operator = (const WebsocketBlockCache &) = delete;
+
+private:
+    static const size_t                                     s_max_block_count = 64;
+
+private:
+    size_t                                                  m_block_size;
+    std::vector<void *>                                     m_blocks;
+    std::mutex                                              m_mutex;
+};
+
+template <typename T>
+class WebsocketBlockAllocator
+{
+public:
+    typedef T value_type;
+
+public:
+    explicit WebsocketBlockAllocator(const std::shared_ptr<WebsocketBlockCache> & cache)
+        : m_cache(cache)
+    {
+
+    }
+
+    template <typename U>
+    WebsocketBlockAllocator(const WebsocketBlockAllocator<U> & other)
+        : m_cache(other.cache())
+    {
+
+    }
+
+public:
+    T * allocate(size_t count)
+    {
+        return static_cast<T *>(m_cache->allocate(count * sizeof(T)));
+    }
+
+    void deallocate(T * block, size_t count)
+    {
+        m_cache->deallocate(block, count * sizeof(T));
+    }
+
+    const std::shared_ptr<WebsocketBlockCache> & cache() const
+    {
+        return m_cache;
+    }
+
+private:
+    std::shared_ptr<WebsocketBlockCache>                    m_cache; /* the control block is freed through a copy of its allocator, which keeps the cache alive until then */
+};
+
+template <typename T, typename U>
+bool operator == (const WebsocketBlockAllocator<T> & lhs, const WebsocketBlockAllocator<U> & rhs)
+{
+    return lhs.cache() == rhs.cache();
+}
+
+template <typename T, typename U>
+bool operator != (const WebsocketBlockAllocator<T> & lhs, const WebsocketBlockAllocator<U> & rhs)
+{
+    return lhs.cache() != rhs.cache();
+}
+
+/*
+ * a websocketpp con_msg_manager that recycles messages instead of making a
+ * new one (and growing a new payload string) for every frame: a released
+ * message keeps its payload capacity and goes back to the free list of its
+ * size class, from which the next request of that size is served, and the
+ * control blocks of the message pointers come from a block cache, so a
+ * frame served from the pool takes neither a message, a payload nor a
+ * control block from the heap; websocketpp makes a manager per connection,
+ * each with free lists of its own, which hold at most s_max_pooled_bytes of
+ * payload and live on while a message taken from them is still out
+ */
+template <typename message>
+class WebsocketMessagePool
+{
+public:
+    typedef WebsocketMessagePool<message> type;
+    typedef std::shared_ptr<type> ptr;
+    typedef std::weak_ptr<type> weak_ptr;
+    typedef typename message::ptr message_ptr;
+
+public:
+    WebsocketMessagePool();
+
+public:
+    message_ptr get_message();
+    message_ptr get_message(websocketpp::frame::opcode::value op, size_t size);
+
+private:
+    WebsocketMessagePool(const WebsocketMessagePool &) = delete;
+    WebsocketMessagePool & operator = (const WebsocketMessagePool &) = delete;
+
+private:
+    static const size_t                                     s_min_capacity = 256;
+    static const size_t                                     s_class_count = 13; /* 256 B ~ 1 MiB */
+    static const size_t                                     s_max_class_messages = 16;
+    static const size_t                                     s_max_pooled_bytes = 2 * 1024 * 1024;
+
+private:
+    struct Store
+    {
+        Store();
+        ~Store();
+
+        bool recycle(message * msg); /* takes msg back if there is room for it */
+
+        std::vector<message *>                              free_lists[s_class_count];
+        size_t                                              pooled_bytes;
+        std::mutex                                          mutex; /* messages of the connection come back on its io thread, sent ones are taken on the caller's */
+        WebsocketBlockCache                                 block_cache;
+    };
+
+    /* the allocator of the control block holds the store, which outlives the call of its deleter */
+    struct Recycler
+    {
+        void operator () (message * msg) const;
+
+        Store                                             * store;
+    };
+
+private:
+    message_ptr acquire(websocketpp::frame::opcode::value op, size_t size);
+
+private:
+    std::shared_ptr<Store>                                  m_store;
+    WebsocketBlockAllocator<message>                        m_allocator;
+};
+
+template <typename message>
+WebsocketMessagePool<message>::Store::Store()
+    : free_lists()
+    , pooled_bytes(0)
+    , mutex()
+    , block_cache()
+{
+
+}
+
+template <typename message>
+WebsocketMessagePool<message>::Store::~Store()
+{
+    for (size_t index = 0; index < s_class_count; ++index)
+    {
+        for (typename std::vector<message *>::iterator iter = free_lists[index].begin(); free_lists[index].end() != iter; ++iter)
+        {
+            delete *iter;
+        }
+        free_lists[index].clear();
+    }
+    pooled_bytes = 0;
+}
+
+template <typename message>
+WebsocketMessagePool<message>::WebsocketMessagePool()
+    : m_store(std::make_shared<Store>())
+    , m_allocator(std::shared_ptr<WebsocketBlockCache>(m_store, &m_store->block_cache))
+{
+
+}
+
+template <typename message>
+typename WebsocketMessagePool<message>::message_ptr WebsocketMessagePool<message>::get_message()
+{
+    return acquire(websocketpp::frame::opcode::TEXT, 0);
+}
+
+template <typename message>
+typename WebsocketMessagePool<message>::message_ptr WebsocketMessagePool<message>::get_message(websocketpp::frame::opcode::value op, size_t size)
+{
+    return acquire(op, size);
+}
+
+template <typename message>
+typename WebsocketMessagePool<message>::message_ptr WebsocketMessagePool<message>::acquire(websocketpp::frame::opcode::value op, size_t size)
+{
+    Store & pool = *m_store;
+
+    /* the smallest class whose capacity fits size */
+    size_t index = 0;
+    while (index < s_class_count && (s_min_capacity << index) < size)
+    {
+        ++index;
+    }
+
+    message * msg = nullptr;
+    if (index < s_class_count)
+    {
+        std::lock_guard<std::mutex> locker(pool.mutex);
+        std::vector<message *> & free_list = pool.free_lists[index];
+        if (!free_list.empty())
+        {
+            msg = free_list.back();
+            free_list.pop_back();
+            pool.pooled_bytes -= msg->get_raw_payload().capacity();
+        }
+    }
+
+    if (nullptr == msg)
+    {
+        msg = new message(typename message::con_msg_man_ptr(), op, (index < s_class_count) ? (s_min_capacity << index) : size);
+    }
+    else
+    {
+        msg->set_opcode(op);
+    }
+
+    Recycler recycler;
+    recycler.store = &pool;
+    return message_ptr(msg, recycler, m_allocator);
+}
+
+template <typename message>
+bool WebsocketMessagePool<message>::Store::recycle(message * msg)
+{
+    std::string & payload = msg->get_raw_payload();
+    size_t capacity = payload.capacity();
+    if (capacity < s_min_capacity || capacity > (s_min_capacity << s_class_count))
+    {
+        return false;
+    }
+
+    /* the largest class whose capacity the payload still has */
+    size_t index = 0;
+    while (index + 1 < s_class_count && (s_min_capacity << (index + 1)) <= capacity)
+    {
+        ++index;
+    }
+
+    payload.clear();
+    msg->set_header(std::string());
+    msg->set_prepared(false);
+    msg->set_fin(true);
+    msg->set_terminal(false);
+    msg->set_compressed(false);
+
+    std::lock_guard<std::mutex> locker(mutex);
+    std::vector<message *> & free_list = free_lists[index];
+    if (free_list.size() >= s_max_class_messages || pooled_bytes + capacity > s_max_pooled_bytes)
+    {
+        return false;
+    }
+    free_list.push_back(msg);
+    pooled_bytes += capacity;
+
+    return true;
+}
+
+template <typename message>
+void WebsocketMessagePool<message>::Recycler::operator () (message * msg) const
+{
+    if (!store->recycle(msg))
+    {
+        delete msg;
+    }
+}
+
+#endif // WEBSOCKET_MESSAGE_POOL_H
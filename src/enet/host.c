@@ -83,6 +83,11 @@ enet_host_create (const ENetAddress * address, size_t peerCount, size_t channelL
     host -> bandwidthThrottleEpoch = 0;
     host -> recalculateBandwidthLimits = 0;
     host -> mtu = ENET_HOST_DEFAULT_MTU;
+    host -> mtuProbing = 0;
+    host -> congestionControl = ENET_CONGESTION_CONTROL_THROTTLE;
+    host -> pacing = 0;
+    host -> pacingTimeout = 0;
+    host -> acknowledgeRanges = 0;
     host -> peerCount = peerCount;
     host -> commandCount = 0;
     host -> bufferCount = 0;
@@ -110,6 +115,25 @@ enet_host_create (const ENetAddress * address, size_t peerCount, size_t channelL
 
     host -> intercept = NULL;
 
+    host -> receiveBatchBuffers = NULL;
+    host -> receiveBatchAddresses = NULL;
+    host -> receiveBatchLengths = NULL;
+    host -> receiveBatchSize = 0;
+    host -> receiveBatchCount = 0;
+    host -> receiveBatchIndex = 0;
+
+    host -> sendBatchBuffers = NULL;
+    host -> sendBatchAddresses = NULL;
+    host -> sendBatchSize = 0;
+    host -> sendBatchCount = 0;
+    host -> sendBatchSegmentation = 0;
+
+    host -> outgoingCommandPool = NULL;
+    host -> incomingCommandPool = NULL;
+    host -> acknowledgementPool = NULL;
+    host -> packetPool = NULL;
+    host -> packetPoolDataLength = 0;
+
     enet_list_clear (& host -> dispatchQueue);
 
     for (currentPeer = host -> peers;
@@ -156,6 +180,17 @@ enet_host_destroy (ENetHost * host)
     if (host -> compressor.context != NULL && host -> compressor.destroy)
       (* host -> compressor.destroy) (host -> compressor.context);
 
+    if (host -> receiveBatchBuffers != NULL)
+      enet_free (host -> receiveBatchBuffers);
+
+    if (host -> sendBatchBuffers != NULL)
+      enet_free (host -> sendBatchBuffers);
+
+    enet_pool_destroy (host -> outgoingCommandPool);
+    enet_pool_destroy (host -> incomingCommandPool);
+    enet_pool_destroy (host -> acknowledgementPool);
+    enet_pool_destroy (host -> packetPool);
+
     enet_free (host -> peers);
     enet_free (host);
 }
@@ -236,11 +271,21 @@ enet_host_connect (ENetHost * host, const ENetAddress * address, size_t channelC
         enet_list_clear (& channel -> incomingReliableCommands);
         enet_list_clear (& channel -> incomingUnreliableCommands);
 
+        channel -> incomingReliableRing = NULL;
+        channel -> incomingReliableSlots = NULL;
+        channel -> incomingReliableOverflow = 0;
+        channel -> sentReliableRing = NULL;
+        channel -> sentReliableOrder = NULL;
+        channel -> sentReliableOrderBegin = 0;
+        channel -> sentReliableOrderEnd = 0;
+
         channel -> usedReliableWindows = 0;
         memset (channel -> reliableWindows, 0, sizeof (channel -> reliableWindows));
     }
         
     command.header.command = ENET_PROTOCOL_COMMAND_CONNECT | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE;
+    if (host -> acknowledgeRanges)
+      command.header.command |= ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE_RANGES;
     command.header.channelID = 0xFF;
     command.connect.outgoingPeerID = ENET_HOST_TO_NET_16 (currentPeer -> incomingPeerID);
     command.connect.incomingSessionID = currentPeer -> incomingSessionID;
@@ -318,6 +363,264 @@ enet_host_channel_limit (ENetHost * host, size_t channelLimit)
 }
 
 
+/** Sets the number of datagrams a host reads from its socket per system call.
+    @param host host to adjust
+    @param batchSize number of datagrams per receive, up to ENET_HOST_MAXIMUM_BATCH_SIZE; 0 or 1 reads one datagram at a time
+    @retval 0 on success
+    @retval < 0 on failure, or if datagrams of the previous batch are still waiting to be handled
+    @remarks Where the system supports it (recvmmsg on Linux) a whole burst of datagrams is read with
+    one system call into a ring of MTU sized buffers, at the cost of that much memory per host.
+*/
+int
+enet_host_receive_batch (ENetHost * host, size_t batchSize)
+{
+    enet_uint8 * batch;
+    size_t batchIndex;
+
+    if (host -> receiveBatchIndex < host -> receiveBatchCount)
+      return -1;
+
+    if (batchSize > ENET_HOST_MAXIMUM_BATCH_SIZE)
+      batchSize = ENET_HOST_MAXIMUM_BATCH_SIZE;
+
+    if (host -> receiveBatchBuffers != NULL)
+    {
+       enet_free (host -> receiveBatchBuffers);
+
+       host -> receiveBatchBuffers = NULL;
+       host -> receiveBatchAddresses = NULL;
+       host -> receiveBatchLengths = NULL;
+       host -> receiveBatchSize = 0;
+       host -> receiveBatchCount = 0;
+       host -> receiveBatchIndex = 0;
+    }
+
+    if (batchSize <= 1)
+      return 0;
+
+    batch = (enet_uint8 *) enet_malloc (batchSize * (sizeof (ENetBuffer) + sizeof (size_t) + sizeof (ENetAddress) + ENET_PROTOCOL_MAXIMUM_MTU));
+    if (batch == NULL)
+      return -1;
+
+    host -> receiveBatchBuffers = (ENetBuffer *) batch;
+    host -> receiveBatchLengths = (size_t *) & host -> receiveBatchBuffers [batchSize];
+    host -> receiveBatchAddresses = (ENetAddress *) & host -> receiveBatchLengths [batchSize];
+    batch = (enet_uint8 *) & host -> receiveBatchAddresses [batchSize];
+
+    for (batchIndex = 0; batchIndex < batchSize; ++ batchIndex)
+    {
+       host -> receiveBatchBuffers [batchIndex].data = batch + batchIndex * ENET_PROTOCOL_MAXIMUM_MTU;
+       host -> receiveBatchBuffers [batchIndex].dataLength = ENET_PROTOCOL_MAXIMUM_MTU;
+    }
+
+    host -> receiveBatchSize = batchSize;
+
+    return 0;
+}
+
+/** Makes a host queue the datagrams built during one service pass and send them together.
+    @param host host to adjust
+    @param batchSize number of datagrams queued before they are sent, up to ENET_HOST_MAXIMUM_BATCH_SIZE; 0 or 1 sends each datagram as soon as it is built
+    @param segmentation if non-zero, consecutive datagrams of equal size to the same peer are handed to the
+    system as a single UDP GSO buffer where supported, which is turned off again if the system rejects it
+    @retval 0 on success
+    @retval < 0 on failure
+    @remarks Where the system supports it (sendmmsg on Linux) the queue costs one system call, so a large
+    fragmented message no longer costs one system call per datagram.  Queued datagrams are always sent
+    before enet_host_service() or enet_host_flush() returns.
+*/
+int
+enet_host_send_batch (ENetHost * host, size_t batchSize, int segmentation)
+{
+    enet_uint8 * batch;
+    size_t batchIndex;
+
+    if (host -> sendBatchCount > 0)
+      return -1;
+
+    if (batchSize > ENET_HOST_MAXIMUM_BATCH_SIZE)
+      batchSize = ENET_HOST_MAXIMUM_BATCH_SIZE;
+
+    if (host -> sendBatchBuffers != NULL)
+    {
+       enet_free (host -> sendBatchBuffers);
+
+       host -> sendBatchBuffers = NULL;
+       host -> sendBatchAddresses = NULL;
+       host -> sendBatchSize = 0;
+       host -> sendBatchSegmentation = 0;
+    }
+
+    if (batchSize <= 1)
+      return 0;
+
+    batch = (enet_uint8 *) enet_malloc (batchSize * (sizeof (ENetBuffer) + sizeof (ENetAddress) + ENET_PROTOCOL_MAXIMUM_MTU));
+    if (batch == NULL)
+      return -1;
+
+    host -> sendBatchBuffers = (ENetBuffer *) batch;
+    host -> sendBatchAddresses = (ENetAddress *) & host -> sendBatchBuffers [batchSize];
+    batch = (enet_uint8 *) & host -> sendBatchAddresses [batchSize];
+
+    for (batchIndex = 0; batchIndex < batchSize; ++ batchIndex)
+    {
+       host -> sendBatchBuffers [batchIndex].data = batch + batchIndex * ENET_PROTOCOL_MAXIMUM_MTU;
+       host -> sendBatchBuffers [batchIndex].dataLength = 0;
+    }
+
+    host -> sendBatchSize = batchSize;
+    host -> sendBatchSegmentation = segmentation != 0;
+
+    return 0;
+}
+
+/** Makes a host allocate its commands, acknowledgements and received packets from pools of its own.
+    @param host host to adjust
+    @param enable non-zero to allocate from pools, zero to allocate each object from the heap again
+    @param packetDataLength payloads of pooled packets up to this length are stored inside the packet
+    @retval 0 on success
+    @retval < 0 on failure, or if any peer of the host is not disconnected
+    @remarks Pools are not shared between hosts and take no locks, so once warmed up the send and
+    receive paths do no heap allocation for small packets.  A packet from enet_host_packet_create()
+    or enet_peer_receive() of a pooling host must be destroyed on the thread servicing that host, it
+    may outlive the host itself.
+*/
+int
+enet_host_pool (ENetHost * host, int enable, size_t packetDataLength)
+{
+    ENetPeer * currentPeer;
+
+    for (currentPeer = host -> peers;
+         currentPeer < & host -> peers [host -> peerCount];
+         ++ currentPeer)
+    {
+       if (currentPeer -> state != ENET_PEER_STATE_DISCONNECTED)
+         return -1;
+    }
+
+    enet_pool_destroy (host -> outgoingCommandPool);
+    enet_pool_destroy (host -> incomingCommandPool);
+    enet_pool_destroy (host -> acknowledgementPool);
+    enet_pool_destroy (host -> packetPool);
+
+    host -> outgoingCommandPool = NULL;
+    host -> incomingCommandPool = NULL;
+    host -> acknowledgementPool = NULL;
+    host -> packetPool = NULL;
+    host -> packetPoolDataLength = 0;
+
+    if (! enable)
+      return 0;
+
+    if (packetDataLength > ENET_PROTOCOL_MAXIMUM_MTU)
+      packetDataLength = ENET_PROTOCOL_MAXIMUM_MTU;
+
+    host -> outgoingCommandPool = enet_pool_create (sizeof (ENetOutgoingCommand));
+    host -> incomingCommandPool = enet_pool_create (sizeof (ENetIncomingCommand));
+    host -> acknowledgementPool = enet_pool_create (sizeof (ENetAcknowledgement));
+    host -> packetPool = enet_pool_create (sizeof (ENetPacket) + packetDataLength);
+
+    if (host -> outgoingCommandPool == NULL || host -> incomingCommandPool == NULL ||
+        host -> acknowledgementPool == NULL || host -> packetPool == NULL)
+    {
+       enet_host_pool (host, 0, 0);
+
+       return -1;
+    }
+
+    host -> packetPoolDataLength = packetDataLength;
+
+    return 0;
+}
+
+/** Sets the MTU a host offers in new connections and whether its peers probe the path for it.
+    @param host host to adjust
+    @param mtu largest datagram payload the host sends or receives, clamped to the protocol limits
+    @param probe non-zero to have each peer, once connected, start from the minimum MTU and discover
+    how large a datagram the path carries before sending any larger datagram
+    @retval 0 on success
+    @retval < 0 on failure, if the socket cannot be told not to fragment datagrams
+    @remarks Connections use the MTU the connecting side offers, and each side probes only the
+    path of the datagrams it sends, so probing must be enabled on both hosts to cover both
+    directions.  Probes are acknowledged pings padded to the probed size, which every ENet peer
+    understands.  Connected peers keep their MTU.
+*/
+int
+enet_host_mtu (ENetHost * host, enet_uint32 mtu, int probe)
+{
+    ENetPeer * currentPeer;
+
+    if (mtu < ENET_PROTOCOL_MINIMUM_MTU)
+      mtu = ENET_PROTOCOL_MINIMUM_MTU;
+    else
+    if (mtu > ENET_PROTOCOL_MAXIMUM_MTU)
+      mtu = ENET_PROTOCOL_MAXIMUM_MTU;
+
+    if (enet_socket_set_option (host -> socket, ENET_SOCKOPT_DONTFRAGMENT, probe != 0) < 0 && probe)
+      return -1;
+
+    host -> mtu = mtu;
+    host -> mtuProbing = probe != 0;
+
+    for (currentPeer = host -> peers;
+         currentPeer < & host -> peers [host -> peerCount];
+         ++ currentPeer)
+    {
+       if (currentPeer -> state == ENET_PEER_STATE_DISCONNECTED)
+         currentPeer -> mtu = mtu;
+    }
+
+    return 0;
+}
+
+/** Selects how a host limits the reliable data in transit to each of its peers.
+    @param host host to adjust
+    @param congestionControl one of ENetCongestionControl
+    @remarks With ENET_CONGESTION_CONTROL_CUBIC the window a peer negotiated only caps the congestion
+    window if either side limited its bandwidth, otherwise the congestion window may grow up to
+    ENET_PEER_CONGESTION_MAXIMUM_WINDOW, well past the classic 64 KiB.  Unreliable packets are still
+    dropped by the packet throttle in either mode.  Peers that are already connected switch with the
+    congestion window they have grown or been reset to so far.
+*/
+void
+enet_host_congestion_control (ENetHost * host, ENetCongestionControl congestionControl)
+{
+    host -> congestionControl = congestionControl;
+}
+
+/** Turns pacing of the datagrams a host sends on or off.
+    @param host host to adjust
+    @param pacing nonzero to pace, 0 to send whatever the window allows at once
+    @remarks A paced host hands datagrams carrying commands to each peer over to the socket no faster
+    than a token bucket refilled at the window of the peer (its congestion window, or its throttled
+    window) per round trip time allows, so that a full window does not reach the network as one
+    burst that overflows the queue of a router with a shallow buffer.  Acknowledgements are never
+    held back.  The bucket holds ENET_PEER_PACING_INTERVAL microseconds worth of data, but at least
+    ENET_PEER_PACING_BURST datagrams, since a host is only serviced with millisecond timeouts.
+    enet_host_service() and enet_host_service_timeout() wake up in time for held back peers.
+*/
+void
+enet_host_pacing (ENetHost * host, int pacing)
+{
+    host -> pacing = pacing;
+    host -> pacingTimeout = 0;
+}
+
+/** Lets a host acknowledge runs of reliable commands with one command.
+    @param host host to adjust
+    @param acknowledgeRanges nonzero to offer range acknowledgements to peers, 0 to acknowledge every command on its own
+    @remarks A host offers range acknowledgements in its connect or verify connect command, and only peers
+    whose host offered them as well are sent an ENET_PROTOCOL_COMMAND_ACKNOWLEDGE_RANGE, which acknowledges
+    consecutive sequence numbers of a channel, such as the fragments of a large packet, in place of one
+    acknowledgement each.  Peers of older versions of ENet do not offer them and keep getting one acknowledgement
+    per command.  Only connections made after the call are affected.
+*/
+void
+enet_host_acknowledge_ranges (ENetHost * host, int acknowledgeRanges)
+{
+    host -> acknowledgeRanges = acknowledgeRanges;
+}
+
 /** Adjusts the bandwidth limits of a host.
     @param host host to adjust
     @param incomingBandwidth new incoming bandwidth
@@ -336,7 +639,7 @@ enet_host_bandwidth_limit (ENetHost * host, enet_uint32 incomingBandwidth, enet_
 void
 enet_host_bandwidth_throttle (ENetHost * host)
 {
-    enet_uint32 timeCurrent = enet_time_get (),
+    enet_uint32 timeCurrent = host -> serviceTime,
            elapsedTime = timeCurrent - host -> bandwidthThrottleEpoch,
            peersRemaining = (enet_uint32) host -> connectedPeers,
            dataTotal = ~0,
@@ -0,0 +1,388 @@
+/**
+ @file lz.c
+ @brief A fast LZ77 packet coder with an optional preset dictionary
+*/
+#define ENET_BUILDING_LIB 1
+#include <string.h>
+#include "enet.h"
+
+/*
+ * The compressed form is a series of sequences, each a token byte holding
+ * the literal length in its high nibble and the match length minus the
+ * minimum match in its low nibble, a nibble of 15 being continued by bytes
+ * that are added until one is below 255, then the literals, then a 16 bit
+ * little endian match offset. The last sequence ends after its literals.
+ * Offsets reaching before the start of the packet refer to the end of the
+ * dictionary, which both hosts must have been created with.
+ */
+enum
+{
+    ENET_LZ_CODER_HASH_LOG           = 12,
+    ENET_LZ_CODER_HASH_SIZE          = 1 << ENET_LZ_CODER_HASH_LOG,
+    ENET_LZ_CODER_MINIMUM_MATCH      = 4,
+    ENET_LZ_CODER_LENGTH_MASK        = 15,
+    ENET_LZ_CODER_MAXIMUM_OFFSET     = 0xFFFF,
+    ENET_LZ_CODER_MAXIMUM_DICTIONARY = ENET_LZ_CODER_MAXIMUM_OFFSET,
+    ENET_LZ_CODER_SKIP_TRIGGER       = 6
+};
+
+typedef struct _ENetLZCoder
+{
+    /* hash entries of the current packet are tagged with its generation, so a packet
+       starts from the dictionary entries without clearing or copying the table */
+    enet_uint32 generation;
+    enet_uint32 hashGenerations [ENET_LZ_CODER_HASH_SIZE];
+    enet_uint32 hashPositions [ENET_LZ_CODER_HASH_SIZE];
+    enet_uint32 dictionaryPositions [ENET_LZ_CODER_HASH_SIZE];
+    size_t dictionaryLength;
+    /* the dictionary followed by the packet being compressed */
+    enet_uint8 window [ENET_LZ_CODER_MAXIMUM_DICTIONARY + ENET_PROTOCOL_MAXIMUM_MTU];
+} ENetLZCoder;
+
+static enet_uint32
+enet_lz_coder_read_32 (const enet_uint8 * data)
+{
+    enet_uint32 value;
+
+    memcpy (& value, data, sizeof (enet_uint32));
+
+    return value;
+}
+
+static enet_uint32
+enet_lz_coder_hash (const enet_uint8 * data)
+{
+    return (enet_lz_coder_read_32 (data) * 2654435761U) >> (32 - ENET_LZ_CODER_HASH_LOG);
+}
+
+void *
+enet_lz_coder_create (const void * dictionary, size_t dictionaryLength)
+{
+    ENetLZCoder * lzCoder = (ENetLZCoder *) enet_malloc (sizeof (ENetLZCoder));
+    size_t position;
+
+    if (lzCoder == NULL)
+      return NULL;
+
+    memset (lzCoder -> hashGenerations, 0, sizeof (lzCoder -> hashGenerations));
+    memset (lzCoder -> dictionaryPositions, 0, sizeof (lzCoder -> dictionaryPositions));
+
+    lzCoder -> generation = 1;
+
+    if (dictionary == NULL)
+      dictionaryLength = 0;
+
+    /* only the tail of a long dictionary is within reach of an offset */
+    if (dictionaryLength > ENET_LZ_CODER_MAXIMUM_DICTIONARY)
+    {
+        dictionary = (const enet_uint8 *) dictionary + dictionaryLength - ENET_LZ_CODER_MAXIMUM_DICTIONARY;
+        dictionaryLength = ENET_LZ_CODER_MAXIMUM_DICTIONARY;
+    }
+
+    if (dictionaryLength > 0)
+      memcpy (lzCoder -> window, dictionary, dictionaryLength);
+
+    lzCoder -> dictionaryLength = dictionaryLength;
+
+    for (position = 0; position + ENET_LZ_CODER_MINIMUM_MATCH <= dictionaryLength; ++ position)
+      lzCoder -> dictionaryPositions [enet_lz_coder_hash (& lzCoder -> window [position])] = (enet_uint32) position + 1;
+
+    return lzCoder;
+}
+
+void
+enet_lz_coder_destroy (void * context)
+{
+    ENetLZCoder * lzCoder = (ENetLZCoder *) context;
+    if (lzCoder == NULL)
+      return;
+
+    enet_free (lzCoder);
+}
+
+static enet_uint8 *
+enet_lz_coder_encode_length (enet_uint8 * outData, const enet_uint8 * outEnd, size_t length)
+{
+    for (; length >= 255; length -= 255)
+    {
+        if (outData >= outEnd)
+          return NULL;
+
+        * outData ++ = 255;
+    }
+
+    if (outData >= outEnd)
+      return NULL;
+
+    * outData ++ = (enet_uint8) length;
+
+    return outData;
+}
+
+static enet_uint8 *
+enet_lz_coder_encode_sequence (enet_uint8 * outData, const enet_uint8 * outEnd, const enet_uint8 * literals, size_t literalLength, size_t offset, size_t matchLength)
+{
+    enet_uint8 * token = outData ++;
+
+    if (token >= outEnd)
+      return NULL;
+
+    if (literalLength >= ENET_LZ_CODER_LENGTH_MASK)
+    {
+        * token = ENET_LZ_CODER_LENGTH_MASK << 4;
+
+        outData = enet_lz_coder_encode_length (outData, outEnd, literalLength - ENET_LZ_CODER_LENGTH_MASK);
+        if (outData == NULL)
+          return NULL;
+    }
+    else
+      * token = (enet_uint8) (literalLength << 4);
+
+    if ((size_t) (outEnd - outData) < literalLength)
+      return NULL;
+
+    memcpy (outData, literals, literalLength);
+    outData += literalLength;
+
+    if (offset == 0)
+      return outData;
+
+    if (outEnd - outData < 2)
+      return NULL;
+
+    * outData ++ = (enet_uint8) (offset & 0xFF);
+    * outData ++ = (enet_uint8) (offset >> 8);
+
+    matchLength -= ENET_LZ_CODER_MINIMUM_MATCH;
+
+    if (matchLength >= ENET_LZ_CODER_LENGTH_MASK)
+    {
+        * token |= ENET_LZ_CODER_LENGTH_MASK;
+
+        outData = enet_lz_coder_encode_length (outData, outEnd, matchLength - ENET_LZ_CODER_LENGTH_MASK);
+    }
+    else
+      * token |= (enet_uint8) matchLength;
+
+    return outData;
+}
+
+size_t
+enet_lz_coder_compress (void * context, const ENetBuffer * inBuffers, size_t inBufferCount, size_t inLimit, enet_uint8 * outData, size_t outLimit)
+{
+    ENetLZCoder * lzCoder = (ENetLZCoder *) context;
+    enet_uint8 * outStart = outData,
+               * outEnd = & outData [outLimit];
+    const enet_uint8 * window;
+    size_t inputLength = 0, position, anchor, end;
+    unsigned int misses = 0;
+
+    if (lzCoder == NULL || inBufferCount <= 0 || inLimit <= 0 || inLimit > ENET_PROTOCOL_MAXIMUM_MTU)
+      return 0;
+
+    for (; inBufferCount > 0 && inputLength < inLimit; ++ inBuffers, -- inBufferCount)
+    {
+        size_t length = inBuffers -> dataLength;
+
+        if (length > inLimit - inputLength)
+          length = inLimit - inputLength;
+
+        memcpy (& lzCoder -> window [lzCoder -> dictionaryLength + inputLength], inBuffers -> data, length);
+        inputLength += length;
+    }
+
+    if (++ lzCoder -> generation == 0)
+    {
+        memset (lzCoder -> hashGenerations, 0, sizeof (lzCoder -> hashGenerations));
+
+        lzCoder -> generation = 1;
+    }
+
+    window = lzCoder -> window;
+    position = anchor = lzCoder -> dictionaryLength;
+    end = lzCoder -> dictionaryLength + inputLength;
+
+    while (position + ENET_LZ_CODER_MINIMUM_MATCH <= end)
+    {
+        enet_uint32 hash = enet_lz_coder_hash (& window [position]);
+        size_t candidate, matchLength;
+
+        if (lzCoder -> hashGenerations [hash] == lzCoder -> generation)
+          candidate = lzCoder -> hashPositions [hash];
+        else
+        if (lzCoder -> dictionaryPositions [hash] != 0)
+          candidate = lzCoder -> dictionaryPositions [hash] - 1;
+        else
+          candidate = position;
+
+        lzCoder -> hashGenerations [hash] = lzCoder -> generation;
+        lzCoder -> hashPositions [hash] = (enet_uint32) position;
+
+        if (candidate >= position ||
+            position - candidate > ENET_LZ_CODER_MAXIMUM_OFFSET ||
+            enet_lz_coder_read_32 (& window [candidate]) != enet_lz_coder_read_32 (& window [position]))
+        {
+            /* step faster through data that does not compress */
+            position += 1 + (misses ++ >> ENET_LZ_CODER_SKIP_TRIGGER);
+            continue;
+        }
+
+        misses = 0;
+
+        while (position > anchor && candidate > 0 && window [position - 1] == window [candidate - 1])
+        {
+            -- position;
+            -- candidate;
+        }
+
+        matchLength = ENET_LZ_CODER_MINIMUM_MATCH;
+        while (position + matchLength < end && window [candidate + matchLength] == window [position + matchLength])
+          ++ matchLength;
+
+        outData = enet_lz_coder_encode_sequence (outData, outEnd, & window [anchor], position - anchor, position - candidate, matchLength);
+        if (outData == NULL)
+          return 0;
+
+        position += matchLength;
+        anchor = position;
+    }
+
+    outData = enet_lz_coder_encode_sequence (outData, outEnd, & window [anchor], end - anchor, 0, 0);
+    if (outData == NULL)
+      return 0;
+
+    return (size_t) (outData - outStart);
+}
+
+static int
+enet_lz_coder_decode_length (const enet_uint8 ** inData, const enet_uint8 * inEnd, size_t * length)
+{
+    enet_uint8 value;
+
+    do
+    {
+        if (* inData >= inEnd)
+          return -1;
+
+        value = * (* inData) ++;
+        * length += value;
+    }
+    while (value == 255);
+
+    return 0;
+}
+
+size_t
+enet_lz_coder_decompress (void * context, const enet_uint8 * inData, size_t inLimit, enet_uint8 * outData, size_t outLimit)
+{
+    ENetLZCoder * lzCoder = (ENetLZCoder *) context;
+    const enet_uint8 * inEnd = & inData [inLimit];
+    enet_uint8 * outStart = outData,
+               * outEnd = & outData [outLimit];
+
+    if (lzCoder == NULL || inLimit <= 0)
+      return 0;
+
+    for (;;)
+    {
+        enet_uint8 token = * inData ++;
+        size_t literalLength = token >> 4,
+               matchLength = token & ENET_LZ_CODER_LENGTH_MASK,
+               offset;
+
+        if (literalLength == ENET_LZ_CODER_LENGTH_MASK &&
+            enet_lz_coder_decode_length (& inData, inEnd, & literalLength) < 0)
+          return 0;
+
+        if ((size_t) (inEnd - inData) < literalLength || (size_t) (outEnd - outData) < literalLength)
+          return 0;
+
+        memcpy (outData, inData, literalLength);
+        inData += literalLength;
+        outData += literalLength;
+
+        if (inData >= inEnd)
+          break;
+
+        if (inEnd - inData < 2)
+          return 0;
+
+        offset = inData [0] | (inData [1] << 8);
+        inData += 2;
+
+        if (matchLength == ENET_LZ_CODER_LENGTH_MASK &&
+            enet_lz_coder_decode_length (& inData, inEnd, & matchLength) < 0)
+          return 0;
+
+        matchLength += ENET_LZ_CODER_MINIMUM_MATCH;
+
+        if (offset == 0 ||
+            offset > (size_t) (outData - outStart) + lzCoder -> dictionaryLength ||
+            (size_t) (outEnd - outData) < matchLength)
+          return 0;
+
+        if (offset > (size_t) (outData - outStart))
+        {
+            /* the match starts in the dictionary and may run on into the packet */
+            const enet_uint8 * match = & lzCoder -> window [lzCoder -> dictionaryLength - (offset - (size_t) (outData - outStart))];
+            size_t dictionaryPart = (size_t) (& lzCoder -> window [lzCoder -> dictionaryLength] - match);
+
+            if (dictionaryPart > matchLength)
+              dictionaryPart = matchLength;
+
+            memcpy (outData, match, dictionaryPart);
+            outData += dictionaryPart;
+            matchLength -= dictionaryPart;
+
+            match = outStart;
+            while (matchLength -- > 0)
+              * outData ++ = * match ++;
+        }
+        else
+        if (offset >= matchLength)
+        {
+            memcpy (outData, outData - offset, matchLength);
+            outData += matchLength;
+        }
+        else
+        {
+            const enet_uint8 * match = outData - offset;
+
+            while (matchLength -- > 0)
+              * outData ++ = * match ++;
+        }
+
+        if (inData >= inEnd)
+          return 0;
+    }
+
+    return (size_t) (outData - outStart);
+}
+
+/** @defgroup host ENet host functions
+    @{
+*/
+
+/** Sets the packet compressor the host should use to the fast LZ coder,
+    which trades some of the range coder's ratio for far less processing.
+    @param host             host to enable the LZ coder for
+    @param dictionary       optional data typical of the packets sent, both hosts must use the same dictionary; may be NULL
+    @param dictionaryLength length of the dictionary, only the last 64 KiB are used
+    @returns 0 on success, < 0 on failure
+*/
+int
+enet_host_compress_with_lz_coder (ENetHost * host, const void * dictionary, size_t dictionaryLength)
+{
+    ENetCompressor compressor;
+    memset (& compressor, 0, sizeof (compressor));
+    compressor.context = enet_lz_coder_create (dictionary, dictionaryLength);
+    if (compressor.context == NULL)
+      return -1;
+    compressor.compress = enet_lz_coder_compress;
+    compressor.decompress = enet_lz_coder_decompress;
+    compressor.destroy = enet_lz_coder_destroy;
+    enet_host_compress (host, & compressor);
+    return 0;
+}
+
+/** @} */
@@ -10,16 +10,10 @@
     @{ 
 */
 
-/** Creates a packet that may be sent to a peer.
-    @param data         initial contents of the packet's data; the packet's data will remain uninitialized if data is NULL.
-    @param dataLength   size of the data allocated for this packet
-    @param flags        flags for this packet as described for the ENetPacket structure.
-    @returns the packet on success, NULL on failure
-*/
-ENetPacket *
-enet_packet_create (const void * data, size_t dataLength, enet_uint32 flags)
+static ENetPacket *
+enet_packet_create_from_pool (ENetPool * pool, size_t inlineDataLength, const void * data, size_t dataLength, enet_uint32 flags)
 {
-    ENetPacket * packet = (ENetPacket *) enet_malloc (sizeof (ENetPacket));
+    ENetPacket * packet = (ENetPacket *) enet_pool_allocate (pool, sizeof (ENetPacket));
     if (packet == NULL)
       return NULL;
 
@@ -30,11 +24,16 @@ enet_packet_create (const void * data, size_t dataLength, enet_uint32 flags)
       packet -> data = NULL;
     else
     {
-       packet -> data = (enet_uint8 *) enet_malloc (dataLength);
-       if (packet -> data == NULL)
+       if (dataLength <= inlineDataLength)
+         packet -> data = (enet_uint8 *) & packet [1];
+       else
        {
-          enet_free (packet);
-          return NULL;
+          packet -> data = (enet_uint8 *) enet_pool_take_buffer (pool, dataLength);
+          if (packet -> data == NULL)
+          {
+             enet_pool_free (pool, packet);
+             return NULL;
+          }
        }
 
        if (data != NULL)
@@ -46,10 +45,37 @@ enet_packet_create (const void * data, size_t dataLength, enet_uint32 flags)
     packet -> dataLength = dataLength;
     packet -> freeCallback = NULL;
     packet -> userData = NULL;
+    packet -> pool = pool;
 
     return packet;
 }
 
+/** Creates a packet that may be sent to a peer.
+    @param data         initial contents of the packet's data; the packet's data will remain uninitialized if data is NULL.
+    @param dataLength   size of the data allocated for this packet
+    @param flags        flags for this packet as described for the ENetPacket structure.
+    @returns the packet on success, NULL on failure
+*/
+ENetPacket *
+enet_packet_create (const void * data, size_t dataLength, enet_uint32 flags)
+{
+    return enet_packet_create_from_pool (NULL, 0, data, dataLength, flags);
+}
+
+/** Creates a packet from the packet pool of a host, see enet_host_pool().
+    Behaves as enet_packet_create() if the host does not pool its objects.
+    @param host         host the packet will be sent from
+    @param data         initial contents of the packet's data; the packet's data will remain uninitialized if data is NULL.
+    @param dataLength   size of the data allocated for this packet
+    @param flags        flags for this packet as described for the ENetPacket structure.
+    @returns the packet on success, NULL on failure
+*/
+ENetPacket *
+enet_host_packet_create (ENetHost * host, const void * data, size_t dataLength, enet_uint32 flags)
+{
+    return enet_packet_create_from_pool (host -> packetPool, host -> packetPoolDataLength, data, dataLength, flags);
+}
+
 /** Destroys the packet and deallocates its data.
     @param packet packet to be destroyed
 */
@@ -62,9 +88,10 @@ enet_packet_destroy (ENetPacket * packet)
     if (packet -> freeCallback != NULL)
       (* packet -> freeCallback) (packet);
     if (! (packet -> flags & ENET_PACKET_FLAG_NO_ALLOCATE) &&
-        packet -> data != NULL)
-      enet_free (packet -> data);
-    enet_free (packet);
+        packet -> data != NULL &&
+        (packet -> pool == NULL || packet -> data != (enet_uint8 *) & packet [1]))
+      enet_pool_keep_buffer (packet -> pool, packet -> data, packet -> dataLength);
+    enet_pool_free (packet -> pool, packet);
 }
 
 /** Attempts to resize the data in the packet to length specified in the 
@@ -90,7 +117,8 @@ enet_packet_resize (ENetPacket * packet, size_t dataLength)
       return -1;
 
     memcpy (newData, packet -> data, packet -> dataLength);
-    enet_free (packet -> data);
+    if (packet -> pool == NULL || packet -> data != (enet_uint8 *) & packet [1])
+      enet_free (packet -> data);
     
     packet -> data = newData;
     packet -> dataLength = dataLength;
@@ -98,68 +126,4 @@ enet_packet_resize (ENetPacket * packet, size_t dataLength)
     return 0;
 }
 
-static int initializedCRC32 = 0;
-static enet_uint32 crcTable [256];
-
-static enet_uint32 
-reflect_crc (int val, int bits)
-{
-    int result = 0, bit;
-
-    for (bit = 0; bit < bits; bit ++)
-    {
-        if(val & 1) result |= 1 << (bits - 1 - bit); 
-        val >>= 1;
-    }
-
-    return result;
-}
-
-static void 
-initialize_crc32 (void)
-{
-    int byte;
-
-    for (byte = 0; byte < 256; ++ byte)
-    {
-        enet_uint32 crc = reflect_crc (byte, 8) << 24;
-        int offset;
-
-        for(offset = 0; offset < 8; ++ offset)
-        {
-            if (crc & 0x80000000)
-                crc = (crc << 1) ^ 0x04c11db7;
-            else
-                crc <<= 1;
-        }
-
-        crcTable [byte] = reflect_crc (crc, 32);
-    }
-
-    initializedCRC32 = 1;
-}
-    
-enet_uint32
-enet_crc32 (const ENetBuffer * buffers, size_t bufferCount)
-{
-    enet_uint32 crc = 0xFFFFFFFF;
-    
-    if (! initializedCRC32) initialize_crc32 ();
-
-    while (bufferCount -- > 0)
-    {
-        const enet_uint8 * data = (const enet_uint8 *) buffers -> data,
-                         * dataEnd = & data [buffers -> dataLength];
-
-        while (data < dataEnd)
-        {
-            crc = (crc >> 8) ^ crcTable [(crc & 0xFF) ^ *data++];        
-        }
-
-        ++ buffers;
-    }
-
-    return ENET_HOST_TO_NET_32 (~ crc);
-}
-
 /** @} */
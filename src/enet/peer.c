@@ -4,6 +4,8 @@
 */
 #include <string.h>
 #define ENET_BUILDING_LIB 1
+#include "utility.h"
+#include "times.h"
 #include "enet.h"
 
 /** @defgroup peer ENet peer functions 
@@ -89,6 +91,163 @@ enet_peer_throttle (ENetPeer * peer, enet_uint32 rtt)
     return 0;
 }
 
+/* the constants of TCP CUBIC (RFC 8312), windows are counted in MTU sized segments */
+#define ENET_PEER_CUBIC_C    0.4
+#define ENET_PEER_CUBIC_BETA 0.7
+
+static double
+enet_peer_cube_root (double value)
+{
+    double root = 1.0;
+    int iteration;
+
+    if (value <= 0.0)
+      return 0.0;
+
+    while (root * root * root < value)
+      root *= 2.0;
+
+    /* Newton's method descends monotonically from above */
+    for (iteration = 0; iteration < 8; ++ iteration)
+      root = (2.0 * root + value / (root * root)) / 3.0;
+
+    return root;
+}
+
+static enet_uint32
+enet_peer_congestion_limit (ENetPeer * peer)
+{
+    /* a window narrowed by the bandwidth limits of either host is honoured */
+    if (peer -> windowSize < ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE)
+      return ENET_MAX (peer -> windowSize, 2 * peer -> mtu);
+
+    return ENET_PEER_CONGESTION_MAXIMUM_WINDOW;
+}
+
+/** Grows the congestion window of a peer for reliable data acknowledged by it.
+    @param peer peer that acknowledged the data
+    @param length bytes of reliable data that were in transit and are acknowledged
+    @param roundTripTime round trip time sample of the acknowledgement, in microseconds
+*/
+void
+enet_peer_congestion_acknowledge (ENetPeer * peer, enet_uint32 length, enet_uint32 roundTripTime)
+{
+    enet_uint32 serviceTime = peer -> host -> serviceTime,
+                queueDelay,
+                increase;
+
+    if (peer -> minimumRoundTripTime == 0 ||
+        roundTripTime <= peer -> minimumRoundTripTime ||
+        ENET_TIME_DIFFERENCE (serviceTime, peer -> minimumRoundTripTimeEpoch) >= ENET_PEER_CONGESTION_MINIMUM_RTT_INTERVAL)
+    {
+        peer -> minimumRoundTripTime = roundTripTime;
+        peer -> minimumRoundTripTimeEpoch = serviceTime;
+    }
+
+    /* a queue building up along the path shows as delay above the lowest round trip time */
+    queueDelay = peer -> minimumRoundTripTime / 8;
+    if (queueDelay < 4000)
+      queueDelay = 4000;
+    else
+    if (queueDelay > 16000)
+      queueDelay = 16000;
+
+    if (peer -> congestionWindow < peer -> congestionThreshold)
+    {
+        if (roundTripTime > peer -> minimumRoundTripTime + queueDelay)
+        {
+            peer -> congestionThreshold = peer -> congestionWindow;
+            peer -> congestionWindowMaximum = peer -> congestionWindow;
+            peer -> congestionEpoch = serviceTime;
+            peer -> congestionPlateauTime = 0;
+            return;
+        }
+
+        increase = length;
+    }
+    else
+    {
+        double elapsed, target;
+
+        if (roundTripTime > peer -> minimumRoundTripTime + queueDelay)
+          return;
+
+        elapsed = ((double) ENET_TIME_DIFFERENCE (serviceTime, peer -> congestionEpoch) - (double) peer -> congestionPlateauTime) / 1000.0;
+        target = peer -> congestionWindowMaximum + ENET_PEER_CUBIC_C * elapsed * elapsed * elapsed * peer -> mtu;
+
+        /* never slower than the additive increase of one segment per window acknowledged */
+        increase = peer -> mtu * length / peer -> congestionWindow;
+        if (target > peer -> congestionWindow)
+        {
+            double cubicIncrease = (target - peer -> congestionWindow) * length / peer -> congestionWindow;
+
+            if (cubicIncrease > length / 2)
+              cubicIncrease = length / 2;
+            if (cubicIncrease > increase)
+              increase = (enet_uint32) cubicIncrease;
+        }
+    }
+
+    peer -> congestionWindow += increase;
+    if (peer -> congestionWindow > enet_peer_congestion_limit (peer))
+      peer -> congestionWindow = enet_peer_congestion_limit (peer);
+}
+
+/** Shrinks the congestion window of a peer after reliable data sent to it was lost, at most
+    once per round trip, since the losses of one round trip are the same congestion event.
+    @param peer peer the data was sent to
+*/
+void
+enet_peer_congestion_loss (ENetPeer * peer)
+{
+    enet_uint32 serviceTime = peer -> host -> serviceTime,
+                minimumWindow = 2 * peer -> mtu;
+
+    if (peer -> congestionEpoch != 0 &&
+        ENET_TIME_DIFFERENCE (serviceTime, peer -> congestionEpoch) < peer -> roundTripTime)
+      return;
+
+    peer -> congestionUndoWindow = peer -> congestionWindow;
+    peer -> congestionUndoThreshold = peer -> congestionThreshold;
+    peer -> congestionUndoWindowMaximum = peer -> congestionWindowMaximum;
+    peer -> congestionUndoEpoch = peer -> congestionEpoch;
+    peer -> congestionUndoPlateauTime = peer -> congestionPlateauTime;
+
+    /* fast convergence, a window lost below the last plateau yields sooner to other flows */
+    if (peer -> congestionWindow < peer -> congestionWindowMaximum)
+      peer -> congestionWindowMaximum = (enet_uint32) (peer -> congestionWindow * (1.0 + ENET_PEER_CUBIC_BETA) / 2.0);
+    else
+      peer -> congestionWindowMaximum = peer -> congestionWindow;
+
+    peer -> congestionWindow = (enet_uint32) (peer -> congestionWindow * ENET_PEER_CUBIC_BETA);
+    if (peer -> congestionWindow < minimumWindow)
+      peer -> congestionWindow = minimumWindow;
+
+    peer -> congestionThreshold = peer -> congestionWindow;
+    peer -> congestionEpoch = ENET_MAX (serviceTime, 1);
+    peer -> congestionPlateauTime = (enet_uint32) (1000.0 * enet_peer_cube_root ((double) peer -> congestionWindowMaximum / peer -> mtu * (1.0 - ENET_PEER_CUBIC_BETA) / ENET_PEER_CUBIC_C));
+}
+
+/** Takes back the last reduction of the congestion window of a peer, once the acknowledgement
+    of the original transmission of a command shows that its retransmission timed out spuriously,
+    as when the queue along the path merely grew past the retransmission timeout.
+    @param peer peer the data was sent to
+*/
+void
+enet_peer_congestion_undo (ENetPeer * peer)
+{
+    if (peer -> congestionUndoWindow == 0)
+      return;
+
+    if (peer -> congestionWindow < peer -> congestionUndoWindow)
+      peer -> congestionWindow = peer -> congestionUndoWindow;
+    peer -> congestionThreshold = peer -> congestionUndoThreshold;
+    peer -> congestionWindowMaximum = peer -> congestionUndoWindowMaximum;
+    peer -> congestionEpoch = peer -> congestionUndoEpoch;
+    peer -> congestionPlateauTime = peer -> congestionUndoPlateauTime;
+    peer -> congestionUndoWindow = 0;
+}
+
 /** Queues a packet to be sent.
     @param peer destination for the packet
     @param channelID channel on which to send
@@ -149,14 +308,14 @@ enet_peer_send (ENetPeer * peer, enet_uint8 channelID, ENetPacket * packet)
          if (packet -> dataLength - fragmentOffset < fragmentLength)
            fragmentLength = packet -> dataLength - fragmentOffset;
 
-         fragment = (ENetOutgoingCommand *) enet_malloc (sizeof (ENetOutgoingCommand));
+         fragment = (ENetOutgoingCommand *) enet_pool_allocate (peer -> host -> outgoingCommandPool, sizeof (ENetOutgoingCommand));
          if (fragment == NULL)
          {
             while (! enet_list_empty (& fragments))
             {
                fragment = (ENetOutgoingCommand *) enet_list_remove (enet_list_begin (& fragments));
                
-               enet_free (fragment);
+               enet_pool_free (peer -> host -> outgoingCommandPool, fragment);
             }
             
             return -1;
@@ -240,7 +399,7 @@ enet_peer_receive (ENetPeer * peer, enet_uint8 * channelID)
    if (incomingCommand -> fragments != NULL)
      enet_free (incomingCommand -> fragments);
 
-   enet_free (incomingCommand);
+   enet_pool_free (peer -> host -> incomingCommandPool, incomingCommand);
 
    peer -> totalWaitingData -= packet -> dataLength;
 
@@ -248,7 +407,7 @@ enet_peer_receive (ENetPeer * peer, enet_uint8 * channelID)
 }
 
 static void
-enet_peer_reset_outgoing_commands (ENetList * queue)
+enet_peer_reset_outgoing_commands (ENetPeer * peer, ENetList * queue)
 {
     ENetOutgoingCommand * outgoingCommand;
 
@@ -264,12 +423,12 @@ enet_peer_reset_outgoing_commands (ENetList * queue)
             enet_packet_destroy (outgoingCommand -> packet);
        }
 
-       enet_free (outgoingCommand);
+       enet_pool_free (peer -> host -> outgoingCommandPool, outgoingCommand);
     }
 }
 
 static void
-enet_peer_remove_incoming_commands (ENetList * queue, ENetListIterator startCommand, ENetListIterator endCommand, ENetIncomingCommand * excludeCommand)
+enet_peer_remove_incoming_commands (ENetPeer * peer, ENetList * queue, ENetListIterator startCommand, ENetListIterator endCommand, ENetIncomingCommand * excludeCommand)
 {
     ENetListIterator currentCommand;    
     
@@ -295,14 +454,14 @@ enet_peer_remove_incoming_commands (ENetList * queue, ENetListIterator startComm
        if (incomingCommand -> fragments != NULL)
          enet_free (incomingCommand -> fragments);
 
-       enet_free (incomingCommand);
+       enet_pool_free (peer -> host -> incomingCommandPool, incomingCommand);
     }
 }
 
 static void
-enet_peer_reset_incoming_commands (ENetList * queue)
+enet_peer_reset_incoming_commands (ENetPeer * peer, ENetList * queue)
 {
-    enet_peer_remove_incoming_commands(queue, enet_list_begin (queue), enet_list_end (queue), NULL);
+    enet_peer_remove_incoming_commands(peer, queue, enet_list_begin (queue), enet_list_end (queue), NULL);
 }
  
 void
@@ -318,12 +477,12 @@ enet_peer_reset_queues (ENetPeer * peer)
     }
 
     while (! enet_list_empty (& peer -> acknowledgements))
-      enet_free (enet_list_remove (enet_list_begin (& peer -> acknowledgements)));
+      enet_pool_free (peer -> host -> acknowledgementPool, enet_list_remove (enet_list_begin (& peer -> acknowledgements)));
 
-    enet_peer_reset_outgoing_commands (& peer -> sentReliableCommands);
-    enet_peer_reset_outgoing_commands (& peer -> sentUnreliableCommands);
-    enet_peer_reset_outgoing_commands (& peer -> outgoingCommands);
-    enet_peer_reset_incoming_commands (& peer -> dispatchedCommands);
+    enet_peer_reset_outgoing_commands (peer, & peer -> sentReliableCommands);
+    enet_peer_reset_outgoing_commands (peer, & peer -> sentUnreliableCommands);
+    enet_peer_reset_outgoing_commands (peer, & peer -> outgoingCommands);
+    enet_peer_reset_incoming_commands (peer, & peer -> dispatchedCommands);
 
     if (peer -> channels != NULL && peer -> channelCount > 0)
     {
@@ -331,8 +490,14 @@ enet_peer_reset_queues (ENetPeer * peer)
              channel < & peer -> channels [peer -> channelCount];
              ++ channel)
         {
-            enet_peer_reset_incoming_commands (& channel -> incomingReliableCommands);
-            enet_peer_reset_incoming_commands (& channel -> incomingUnreliableCommands);
+            enet_peer_reset_incoming_commands (peer, & channel -> incomingReliableCommands);
+            enet_peer_reset_incoming_commands (peer, & channel -> incomingUnreliableCommands);
+
+            if (channel -> incomingReliableRing != NULL)
+              enet_free (channel -> incomingReliableRing);
+
+            if (channel -> sentReliableRing != NULL)
+              enet_free (channel -> sentReliableRing);
         }
 
         enet_free (peer -> channels);
@@ -340,6 +505,8 @@ enet_peer_reset_queues (ENetPeer * peer)
 
     peer -> channels = NULL;
     peer -> channelCount = 0;
+
+    peer -> sentUnindexedCommands = NULL;
 }
 
 void
@@ -394,6 +561,8 @@ enet_peer_reset (ENetPeer * peer)
     peer -> packetLossEpoch = 0;
     peer -> packetsSent = 0;
     peer -> packetsLost = 0;
+    peer -> fastRetransmits = 0;
+    peer -> timeoutRetransmits = 0;
     peer -> packetLoss = 0;
     peer -> packetLossVariance = 0;
     peer -> packetThrottle = ENET_PEER_DEFAULT_PACKET_THROTTLE;
@@ -407,14 +576,35 @@ enet_peer_reset (ENetPeer * peer)
     peer -> timeoutLimit = ENET_PEER_TIMEOUT_LIMIT;
     peer -> timeoutMinimum = ENET_PEER_TIMEOUT_MINIMUM;
     peer -> timeoutMaximum = ENET_PEER_TIMEOUT_MAXIMUM;
-    peer -> lastRoundTripTime = ENET_PEER_DEFAULT_ROUND_TRIP_TIME;
-    peer -> lowestRoundTripTime = ENET_PEER_DEFAULT_ROUND_TRIP_TIME;
+    peer -> lastRoundTripTime = ENET_PEER_DEFAULT_ROUND_TRIP_TIME * 1000;
+    peer -> lowestRoundTripTime = ENET_PEER_DEFAULT_ROUND_TRIP_TIME * 1000;
     peer -> lastRoundTripTimeVariance = 0;
     peer -> highestRoundTripTimeVariance = 0;
     peer -> roundTripTime = ENET_PEER_DEFAULT_ROUND_TRIP_TIME;
     peer -> roundTripTimeVariance = 0;
+    peer -> roundTripTimeMicroseconds = ENET_PEER_DEFAULT_ROUND_TRIP_TIME * 1000;
+    peer -> roundTripTimeVarianceMicroseconds = 0;
     peer -> mtu = peer -> host -> mtu;
+    peer -> mtuProbeLimit = 0;
+    peer -> mtuProbeSize = 0;
+    peer -> mtuProbeTimeout = 0;
+    peer -> mtuProbeSequenceNumber = 0;
+    peer -> mtuProbeAttempts = 0;
     peer -> reliableDataInTransit = 0;
+    peer -> congestionWindow = ENET_PEER_CONGESTION_INITIAL_WINDOW;
+    peer -> congestionThreshold = ENET_PEER_CONGESTION_MAXIMUM_WINDOW;
+    peer -> congestionWindowMaximum = 0;
+    peer -> congestionEpoch = 0;
+    peer -> congestionPlateauTime = 0;
+    peer -> congestionUndoWindow = 0;
+    peer -> congestionUndoThreshold = 0;
+    peer -> congestionUndoWindowMaximum = 0;
+    peer -> congestionUndoEpoch = 0;
+    peer -> congestionUndoPlateauTime = 0;
+    peer -> minimumRoundTripTime = 0;
+    peer -> minimumRoundTripTimeEpoch = 0;
+    peer -> pacingTokens = 0;
+    peer -> pacingTimeMicroseconds = 0;
     peer -> outgoingReliableSequenceNumber = 0;
     peer -> windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
     peer -> incomingUnsequencedGroup = 0;
@@ -602,7 +792,7 @@ enet_peer_queue_acknowledgement (ENetPeer * peer, const ENetProtocol * command,
           return NULL;
     }
 
-    acknowledgement = (ENetAcknowledgement *) enet_malloc (sizeof (ENetAcknowledgement));
+    acknowledgement = (ENetAcknowledgement *) enet_pool_allocate (peer -> host -> acknowledgementPool, sizeof (ENetAcknowledgement));
     if (acknowledgement == NULL)
       return NULL;
 
@@ -616,6 +806,89 @@ enet_peer_queue_acknowledgement (ENetPeer * peer, const ENetProtocol * command,
     return acknowledgement;
 }
 
+static ENetOutgoingCommand **
+enet_peer_sent_reliable_slot (ENetPeer * peer, enet_uint16 reliableSequenceNumber, enet_uint8 channelID)
+{
+    ENetChannel * channel;
+
+    if (channelID >= peer -> channelCount)
+      return NULL;
+
+    channel = & peer -> channels [channelID];
+    if (channel -> sentReliableRing == NULL)
+      return NULL;
+
+    return & channel -> sentReliableRing [reliableSequenceNumber & (ENET_PEER_SENT_RELIABLE_RING_SIZE - 1)];
+}
+
+/** Links a reliable command into the ring of its channel when it is first sent, so that its
+    acknowledgement finds it by sequence number. The sending windows keep fewer commands of a
+    channel in flight than the ring holds in all but extreme cases, in which a slot chains the
+    commands that share it. System commands and those of a channel whose ring could not be
+    allocated are chained on the peer instead. Commands still waiting to be sent for the first
+    time are not linked, as a long enough queue holds several commands with the same channel
+    and sequence number.
+*/
+void
+enet_peer_link_reliable_command (ENetPeer * peer, ENetOutgoingCommand * outgoingCommand)
+{
+    enet_uint8 channelID = outgoingCommand -> command.header.channelID;
+    ENetOutgoingCommand ** link;
+
+    if (channelID < peer -> channelCount && peer -> channels [channelID].sentReliableRing == NULL)
+    {
+       ENetChannel * channel = & peer -> channels [channelID];
+
+       channel -> sentReliableRing = (ENetOutgoingCommand **) enet_malloc (ENET_PEER_SENT_RELIABLE_RING_SIZE * (sizeof (ENetOutgoingCommand *) + sizeof (enet_uint16)));
+       if (channel -> sentReliableRing != NULL)
+       {
+          memset (channel -> sentReliableRing, 0, ENET_PEER_SENT_RELIABLE_RING_SIZE * sizeof (ENetOutgoingCommand *));
+
+          channel -> sentReliableOrder = (enet_uint16 *) & channel -> sentReliableRing [ENET_PEER_SENT_RELIABLE_RING_SIZE];
+          channel -> sentReliableOrderBegin = 0;
+          channel -> sentReliableOrderEnd = 0;
+       }
+    }
+
+    link = enet_peer_sent_reliable_slot (peer, outgoingCommand -> reliableSequenceNumber, channelID);
+    if (link == NULL)
+      link = & peer -> sentUnindexedCommands;
+
+    outgoingCommand -> nextReliableCommand = * link;
+    * link = outgoingCommand;
+}
+
+/** Looks up a sent command awaiting acknowledgement, whether it is in flight or queued for resending.
+    @returns the link that points at the command, so the caller may unlink it, or NULL if none
+*/
+ENetOutgoingCommand **
+enet_peer_find_reliable_command (ENetPeer * peer, enet_uint16 reliableSequenceNumber, enet_uint8 channelID)
+{
+    ENetOutgoingCommand ** link = enet_peer_sent_reliable_slot (peer, reliableSequenceNumber, channelID);
+
+    if (link != NULL)
+    {
+       for (; * link != NULL; link = & (* link) -> nextReliableCommand)
+       {
+          if ((* link) -> reliableSequenceNumber == reliableSequenceNumber)
+            return link;
+       }
+    }
+
+    /* the commands of a channel are chained here until its ring can be allocated */
+
+    for (link = & peer -> sentUnindexedCommands;
+         * link != NULL;
+         link = & (* link) -> nextReliableCommand)
+    {
+       if ((* link) -> reliableSequenceNumber == reliableSequenceNumber &&
+           (* link) -> command.header.channelID == channelID)
+         return link;
+    }
+
+    return NULL;
+}
+
 void
 enet_peer_setup_outgoing_command (ENetPeer * peer, ENetOutgoingCommand * outgoingCommand)
 {
@@ -659,7 +932,10 @@ enet_peer_setup_outgoing_command (ENetPeer * peer, ENetOutgoingCommand * outgoin
     }
 
     outgoingCommand -> sendAttempts = 0;
+    outgoingCommand -> inTransit = 0;
+    outgoingCommand -> nextReliableCommand = NULL;
     outgoingCommand -> sentTime = 0;
+    outgoingCommand -> sentTimeMicroseconds = 0;
     outgoingCommand -> roundTripTimeout = 0;
     outgoingCommand -> roundTripTimeoutLimit = 0;
     outgoingCommand -> command.header.reliableSequenceNumber = ENET_HOST_TO_NET_16 (outgoingCommand -> reliableSequenceNumber);
@@ -684,7 +960,7 @@ enet_peer_setup_outgoing_command (ENetPeer * peer, ENetOutgoingCommand * outgoin
 ENetOutgoingCommand *
 enet_peer_queue_outgoing_command (ENetPeer * peer, const ENetProtocol * command, ENetPacket * packet, enet_uint32 offset, enet_uint16 length)
 {
-    ENetOutgoingCommand * outgoingCommand = (ENetOutgoingCommand *) enet_malloc (sizeof (ENetOutgoingCommand));
+    ENetOutgoingCommand * outgoingCommand = (ENetOutgoingCommand *) enet_pool_allocate (peer -> host -> outgoingCommandPool, sizeof (ENetOutgoingCommand));
     if (outgoingCommand == NULL)
       return NULL;
 
@@ -700,6 +976,133 @@ enet_peer_queue_outgoing_command (ENetPeer * peer, const ENetProtocol * command,
     return outgoingCommand;
 }
 
+static enet_uint32
+enet_peer_highest_bit (enet_uint32 bits)
+{
+#ifdef __GNUC__
+    return 31 - __builtin_clz (bits);
+#else
+    enet_uint32 bit = 0;
+
+    while (bits >>= 1)
+      ++ bit;
+
+    return bit;
+#endif
+}
+
+static int
+enet_peer_reserve_reliable_ring (ENetChannel * channel)
+{
+    if (channel -> incomingReliableRing != NULL)
+      return 0;
+
+    channel -> incomingReliableRing = (ENetIncomingCommand **) enet_malloc (ENET_PEER_RELIABLE_WINDOW_SIZE * sizeof (ENetIncomingCommand *) +
+                                                                              ENET_PEER_RELIABLE_WINDOW_SIZE / 32 * sizeof (enet_uint32));
+    if (channel -> incomingReliableRing == NULL)
+      return -1;
+
+    channel -> incomingReliableSlots = (enet_uint32 *) & channel -> incomingReliableRing [ENET_PEER_RELIABLE_WINDOW_SIZE];
+
+    memset (channel -> incomingReliableSlots, 0, ENET_PEER_RELIABLE_WINDOW_SIZE / 32 * sizeof (enet_uint32));
+
+    return 0;
+}
+
+/* finds the queued reliable command with the highest sequence number that is
+   fewer than distance ahead of the last dispatched one, scanning the slot bitmap
+   a word at a time */
+static ENetIncomingCommand *
+enet_peer_find_previous_reliable_slot (ENetChannel * channel, enet_uint16 distance)
+{
+    enet_uint32 remaining = distance - 1,
+                slot = (channel -> incomingReliableSequenceNumber + distance - 1) & (ENET_PEER_RELIABLE_WINDOW_SIZE - 1);
+
+    while (remaining > 0)
+    {
+        enet_uint32 bitIndex = slot % 32,
+                    span = bitIndex + 1 < remaining ? bitIndex + 1 : remaining,
+                    bits = channel -> incomingReliableSlots [slot / 32];
+
+        if (bitIndex < 31)
+          bits &= (1U << (bitIndex + 1)) - 1;
+        if (span < 32)
+          bits &= ~ ((1U << (bitIndex + 1 - span)) - 1);
+
+        if (bits != 0)
+          return channel -> incomingReliableRing [(slot & ~ 31U) + enet_peer_highest_bit (bits)];
+
+        remaining -= span;
+        slot = (slot - span) & (ENET_PEER_RELIABLE_WINDOW_SIZE - 1);
+    }
+
+    return NULL;
+}
+
+/** Looks up a queued incoming reliable command by its sequence number, through the
+    channel's ring where it can answer and by walking the queue otherwise.
+    @returns the command, or NULL if none with that sequence number is queued
+*/
+ENetIncomingCommand *
+enet_peer_find_incoming_reliable_command (ENetChannel * channel, enet_uint16 reliableSequenceNumber)
+{
+    enet_uint16 reliableDistance = reliableSequenceNumber - channel -> incomingReliableSequenceNumber;
+    ENetListIterator currentCommand;
+
+    if (channel -> incomingReliableRing != NULL && reliableDistance < ENET_PEER_RELIABLE_WINDOW_SIZE)
+    {
+       enet_uint32 slot = reliableSequenceNumber & (ENET_PEER_RELIABLE_WINDOW_SIZE - 1);
+
+       if ((channel -> incomingReliableSlots [slot / 32] & (1U << (slot % 32))) &&
+           channel -> incomingReliableRing [slot] -> reliableSequenceNumber == reliableSequenceNumber)
+         return channel -> incomingReliableRing [slot];
+
+       if (channel -> incomingReliableOverflow == 0)
+         return NULL;
+    }
+
+    for (currentCommand = enet_list_previous (enet_list_end (& channel -> incomingReliableCommands));
+         currentCommand != enet_list_end (& channel -> incomingReliableCommands);
+         currentCommand = enet_list_previous (currentCommand))
+    {
+       ENetIncomingCommand * incomingCommand = (ENetIncomingCommand *) currentCommand;
+
+       if (reliableSequenceNumber >= channel -> incomingReliableSequenceNumber)
+       {
+          if (incomingCommand -> reliableSequenceNumber < channel -> incomingReliableSequenceNumber)
+            continue;
+       }
+       else
+       if (incomingCommand -> reliableSequenceNumber >= channel -> incomingReliableSequenceNumber)
+         break;
+
+       if (incomingCommand -> reliableSequenceNumber <= reliableSequenceNumber)
+       {
+          if (incomingCommand -> reliableSequenceNumber < reliableSequenceNumber)
+            break;
+
+          return incomingCommand;
+       }
+    }
+
+    return NULL;
+}
+
+static void
+enet_peer_remove_reliable_slot (ENetChannel * channel, ENetIncomingCommand * incomingCommand)
+{
+    enet_uint32 slot = incomingCommand -> reliableSequenceNumber & (ENET_PEER_RELIABLE_WINDOW_SIZE - 1);
+
+    if (channel -> incomingReliableRing == NULL)
+      return;
+
+    if ((channel -> incomingReliableSlots [slot / 32] & (1U << (slot % 32))) &&
+        channel -> incomingReliableRing [slot] == incomingCommand)
+      channel -> incomingReliableSlots [slot / 32] &= ~ (1U << (slot % 32));
+    else
+      -- channel -> incomingReliableOverflow;
+}
+
 void
 enet_peer_dispatch_incoming_unreliable_commands (ENetPeer * peer, ENetChannel * channel, ENetIncomingCommand * queuedCommand)
 {
@@ -780,7 +1183,7 @@ enet_peer_dispatch_incoming_unreliable_commands (ENetPeer * peer, ENetChannel *
        droppedCommand = currentCommand;
     }
 
-    enet_peer_remove_incoming_commands (& channel -> incomingUnreliableCommands, enet_list_begin (& channel -> incomingUnreliableCommands), droppedCommand, queuedCommand);
+    enet_peer_remove_incoming_commands (peer, & channel -> incomingUnreliableCommands, enet_list_begin (& channel -> incomingUnreliableCommands), droppedCommand, queuedCommand);
 }
 
 void
@@ -800,6 +1203,8 @@ enet_peer_dispatch_incoming_reliable_commands (ENetPeer * peer, ENetChannel * ch
 
        channel -> incomingReliableSequenceNumber = incomingCommand -> reliableSequenceNumber;
 
+       enet_peer_remove_reliable_slot (channel, incomingCommand);
+
        if (incomingCommand -> fragmentCount > 0)
          channel -> incomingReliableSequenceNumber += incomingCommand -> fragmentCount - 1;
     } 
@@ -829,7 +1234,7 @@ enet_peer_queue_incoming_command (ENetPeer * peer, const ENetProtocol * command,
 
     ENetChannel * channel = & peer -> channels [command -> header.channelID];
     enet_uint32 unreliableSequenceNumber = 0, reliableSequenceNumber = 0;
-    enet_uint16 reliableWindow, currentWindow;
+    enet_uint16 reliableWindow, currentWindow, reliableDistance = 0;
     ENetIncomingCommand * incomingCommand;
     ENetListIterator currentCommand;
     ENetPacket * packet = NULL;
@@ -856,7 +1261,35 @@ enet_peer_queue_incoming_command (ENetPeer * peer, const ENetProtocol * command,
     case ENET_PROTOCOL_COMMAND_SEND_RELIABLE:
        if (reliableSequenceNumber == channel -> incomingReliableSequenceNumber)
          goto discardCommand;
-       
+
+       reliableDistance = (enet_uint16) (reliableSequenceNumber - channel -> incomingReliableSequenceNumber);
+
+       /* a command that is dispatched right away never needs the ring */
+       if (channel -> incomingReliableRing == NULL && (reliableDistance > 1 || fragmentCount > 0) &&
+           enet_peer_reserve_reliable_ring (channel) < 0)
+         goto notifyError;
+
+       if (channel -> incomingReliableRing == NULL)
+       {
+          currentCommand = enet_list_end (& channel -> incomingReliableCommands);
+          break;
+       }
+
+       if (reliableDistance < ENET_PEER_RELIABLE_WINDOW_SIZE && channel -> incomingReliableOverflow == 0)
+       {
+          enet_uint32 slot = reliableSequenceNumber & (ENET_PEER_RELIABLE_WINDOW_SIZE - 1);
+
+          if (channel -> incomingReliableSlots [slot / 32] & (1U << (slot % 32)))
+            goto discardCommand;
+
+          incomingCommand = enet_peer_find_previous_reliable_slot (channel, reliableDistance);
+          if (incomingCommand != NULL)
+            currentCommand = & incomingCommand -> incomingCommandList;
+          else
+            currentCommand = enet_list_end (& channel -> incomingReliableCommands);
+          break;
+       }
+
        for (currentCommand = enet_list_previous (enet_list_end (& channel -> incomingReliableCommands));
             currentCommand != enet_list_end (& channel -> incomingReliableCommands);
             currentCommand = enet_list_previous (currentCommand))
@@ -935,11 +1368,11 @@ enet_peer_queue_incoming_command (ENetPeer * peer, const ENetProtocol * command,
     if (peer -> totalWaitingData >= peer -> host -> maximumWaitingData)
       goto notifyError;
 
-    packet = enet_packet_create (data, dataLength, flags);
+    packet = enet_host_packet_create (peer -> host, data, dataLength, flags);
     if (packet == NULL)
       goto notifyError;
 
-    incomingCommand = (ENetIncomingCommand *) enet_malloc (sizeof (ENetIncomingCommand));
+    incomingCommand = (ENetIncomingCommand *) enet_pool_allocate (peer -> host -> incomingCommandPool, sizeof (ENetIncomingCommand));
     if (incomingCommand == NULL)
       goto notifyError;
 
@@ -957,7 +1390,7 @@ enet_peer_queue_incoming_command (ENetPeer * peer, const ENetProtocol * command,
          incomingCommand -> fragments = (enet_uint32 *) enet_malloc ((fragmentCount + 31) / 32 * sizeof (enet_uint32));
        if (incomingCommand -> fragments == NULL)
        {
-          enet_free (incomingCommand);
+          enet_pool_free (peer -> host -> incomingCommandPool, incomingCommand);
 
           goto notifyError;
        }
@@ -977,6 +1410,19 @@ enet_peer_queue_incoming_command (ENetPeer * peer, const ENetProtocol * command,
     {
     case ENET_PROTOCOL_COMMAND_SEND_FRAGMENT:
     case ENET_PROTOCOL_COMMAND_SEND_RELIABLE:
+       if (channel -> incomingReliableRing != NULL)
+       {
+          if (reliableDistance < ENET_PEER_RELIABLE_WINDOW_SIZE)
+          {
+             enet_uint32 slot = reliableSequenceNumber & (ENET_PEER_RELIABLE_WINDOW_SIZE - 1);
+
+             channel -> incomingReliableRing [slot] = incomingCommand;
+             channel -> incomingReliableSlots [slot / 32] |= 1U << (slot % 32);
+          }
+          else
+            ++ channel -> incomingReliableOverflow;
+       }
+
        enet_peer_dispatch_incoming_reliable_commands (peer, channel, incomingCommand);
        break;
 
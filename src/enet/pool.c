@@ -0,0 +1,197 @@
+/**
+ @file pool.c
+ @brief Per host pools of fixed size objects
+*/
+#define ENET_BUILDING_LIB 1
+#include <string.h>
+#include "enet.h"
+
+enum
+{
+    ENET_POOL_ALIGNMENT    = 16,
+    ENET_POOL_SLAB_OBJECTS = 64,
+    ENET_POOL_SPARE_BUFFER_MINIMUM = 16 * 1024
+};
+
+/*
+ * Objects are carved out of slabs that are only returned to the heap when
+ * the pool is destroyed, free objects are chained through their first word.
+ * A pool is not thread safe, it belongs to the thread servicing its host.
+ *
+ * A pool also keeps the last large data buffer handed back to it, so that
+ * the reassembly of one big fragmented packet after another does not go
+ * back to the heap for every packet.
+ */
+struct _ENetPool
+{
+    size_t objectSize;
+    void * freeObjects;
+    void * slabs;
+    size_t liveObjects;
+    int    released;
+    void * spareBuffer;
+    size_t spareBufferLength;
+};
+
+static size_t
+enet_pool_align (size_t size)
+{
+    return (size + ENET_POOL_ALIGNMENT - 1) & ~ (size_t) (ENET_POOL_ALIGNMENT - 1);
+}
+
+static void
+enet_pool_free_slabs (ENetPool * pool)
+{
+    while (pool -> slabs != NULL)
+    {
+        void * slab = pool -> slabs;
+
+        pool -> slabs = * (void **) slab;
+
+        enet_free (slab);
+    }
+
+    if (pool -> spareBuffer != NULL)
+      enet_free (pool -> spareBuffer);
+
+    enet_free (pool);
+}
+
+ENetPool *
+enet_pool_create (size_t objectSize)
+{
+    ENetPool * pool = (ENetPool *) enet_malloc (sizeof (ENetPool));
+    if (pool == NULL)
+      return NULL;
+
+    if (objectSize < sizeof (void *))
+      objectSize = sizeof (void *);
+
+    pool -> objectSize = enet_pool_align (objectSize);
+    pool -> freeObjects = NULL;
+    pool -> slabs = NULL;
+    pool -> liveObjects = 0;
+    pool -> released = 0;
+    pool -> spareBuffer = NULL;
+    pool -> spareBufferLength = 0;
+
+    return pool;
+}
+
+/** Releases the owner's reference to a pool. Objects still allocated from it,
+    such as packets the application has not destroyed yet, keep it alive until
+    the last of them is freed.
+*/
+void
+enet_pool_destroy (ENetPool * pool)
+{
+    if (pool == NULL)
+      return;
+
+    if (pool -> liveObjects > 0)
+    {
+        pool -> released = 1;
+        return;
+    }
+
+    enet_pool_free_slabs (pool);
+}
+
+/** Allocates an object from the pool, or from the heap with enet_malloc if pool is NULL.
+    @param size size of the object, must not exceed the object size the pool was created with
+*/
+void *
+enet_pool_allocate (ENetPool * pool, size_t size)
+{
+    void * object;
+
+    if (pool == NULL)
+      return enet_malloc (size);
+
+    if (pool -> freeObjects == NULL)
+    {
+        enet_uint8 * slab = (enet_uint8 *) enet_malloc (ENET_POOL_ALIGNMENT + ENET_POOL_SLAB_OBJECTS * pool -> objectSize);
+        size_t index;
+        if (slab == NULL)
+          return NULL;
+
+        * (void **) slab = pool -> slabs;
+        pool -> slabs = slab;
+
+        for (index = ENET_POOL_SLAB_OBJECTS; index > 0; -- index)
+        {
+            void * current = & slab [ENET_POOL_ALIGNMENT + (index - 1) * pool -> objectSize];
+
+            * (void **) current = pool -> freeObjects;
+            pool -> freeObjects = current;
+        }
+    }
+
+    object = pool -> freeObjects;
+    pool -> freeObjects = * (void **) object;
+
+    ++ pool -> liveObjects;
+
+    return object;
+}
+
+/** Returns an object to the pool it was allocated from, or to the heap with enet_free if pool is NULL.
+*/
+void
+enet_pool_free (ENetPool * pool, void * object)
+{
+    if (pool == NULL)
+    {
+        enet_free (object);
+        return;
+    }
+
+    * (void **) object = pool -> freeObjects;
+    pool -> freeObjects = object;
+
+    if (-- pool -> liveObjects == 0 && pool -> released)
+      enet_pool_free_slabs (pool);
+}
+
+/** Allocates a data buffer of at least length bytes, reusing the spare buffer of the pool
+    when it fits without wasting more than half of it, or from the heap otherwise.
+*/
+void *
+enet_pool_take_buffer (ENetPool * pool, size_t length)
+{
+    void * buffer;
+
+    if (pool == NULL ||
+        pool -> spareBuffer == NULL ||
+        length > pool -> spareBufferLength ||
+        length <= pool -> spareBufferLength / 2)
+      return enet_malloc (length);
+
+    buffer = pool -> spareBuffer;
+    pool -> spareBuffer = NULL;
+    pool -> spareBufferLength = 0;
+
+    return buffer;
+}
+
+/** Hands a data buffer of at least length bytes back to the pool, which keeps it as its
+    spare buffer if it is large and bigger than the current spare, and frees it otherwise.
+*/
+void
+enet_pool_keep_buffer (ENetPool * pool, void * buffer, size_t length)
+{
+    if (pool == NULL ||
+        pool -> released ||
+        length < ENET_POOL_SPARE_BUFFER_MINIMUM ||
+        length <= pool -> spareBufferLength)
+    {
+        enet_free (buffer);
+        return;
+    }
+
+    if (pool -> spareBuffer != NULL)
+      enet_free (pool -> spareBuffer);
+
+    pool -> spareBuffer = buffer;
+    pool -> spareBufferLength = length;
+}
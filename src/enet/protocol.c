@@ -23,7 +23,8 @@ static size_t commandSizes [ENET_PROTOCOL_COMMAND_COUNT] =
     sizeof (ENetProtocolSendUnsequenced),
     sizeof (ENetProtocolBandwidthLimit),
     sizeof (ENetProtocolThrottleConfigure),
-    sizeof (ENetProtocolSendFragment)
+    sizeof (ENetProtocolSendFragment),
+    sizeof (ENetProtocolAcknowledgeRange)
 };
 
 size_t
@@ -121,6 +122,16 @@ enet_protocol_notify_connect (ENetHost * host, ENetPeer * peer, ENetEvent * even
 {
     host -> recalculateBandwidthLimits = 1;
 
+    if (host -> mtuProbing &&
+        peer -> mtu >= ENET_PROTOCOL_MINIMUM_MTU + ENET_PEER_MTU_PROBE_GRANULARITY)
+    {
+        /* nothing larger than the minimum MTU is sent until the path is known to carry it,
+           probing starts once the other side has had time to see the connection complete */
+        peer -> mtuProbeLimit = peer -> mtu;
+        peer -> mtu = ENET_PROTOCOL_MINIMUM_MTU;
+        peer -> mtuProbeTimeout = host -> serviceTime + peer -> roundTripTime;
+    }
+
     if (event != NULL)
     {
         enet_protocol_change_state (host, peer, ENET_PEER_STATE_CONNECTED);
@@ -184,7 +195,7 @@ enet_protocol_remove_sent_unreliable_commands (ENetPeer * peer)
            }
         }
 
-        enet_free (outgoingCommand);
+        enet_pool_free (peer -> host -> outgoingCommandPool, outgoingCommand);
     } while (! enet_list_empty (& peer -> sentUnreliableCommands));
 
     if (peer -> state == ENET_PEER_STATE_DISCONNECT_LATER &&
@@ -196,48 +207,19 @@ enet_protocol_remove_sent_unreliable_commands (ENetPeer * peer)
 static ENetProtocolCommand
 enet_protocol_remove_sent_reliable_command (ENetPeer * peer, enet_uint16 reliableSequenceNumber, enet_uint8 channelID)
 {
-    ENetOutgoingCommand * outgoingCommand = NULL;
-    ENetListIterator currentCommand;
+    ENetOutgoingCommand * outgoingCommand, ** link;
     ENetProtocolCommand commandNumber;
-    int wasSent = 1;
-
-    for (currentCommand = enet_list_begin (& peer -> sentReliableCommands);
-         currentCommand != enet_list_end (& peer -> sentReliableCommands);
-         currentCommand = enet_list_next (currentCommand))
-    {
-       outgoingCommand = (ENetOutgoingCommand *) currentCommand;
-        
-       if (outgoingCommand -> reliableSequenceNumber == reliableSequenceNumber &&
-           outgoingCommand -> command.header.channelID == channelID)
-         break;
-    }
-
-    if (currentCommand == enet_list_end (& peer -> sentReliableCommands))
-    {
-       for (currentCommand = enet_list_begin (& peer -> outgoingCommands);
-            currentCommand != enet_list_end (& peer -> outgoingCommands);
-            currentCommand = enet_list_next (currentCommand))
-       {
-          outgoingCommand = (ENetOutgoingCommand *) currentCommand;
+    int wasSent;
 
-          if (! (outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE))
-            continue;
-
-          if (outgoingCommand -> sendAttempts < 1) return ENET_PROTOCOL_COMMAND_NONE;
-
-          if (outgoingCommand -> reliableSequenceNumber == reliableSequenceNumber &&
-              outgoingCommand -> command.header.channelID == channelID)
-            break;
-       }
+    link = enet_peer_find_reliable_command (peer, reliableSequenceNumber, channelID);
+    if (link == NULL)
+      return ENET_PROTOCOL_COMMAND_NONE;
 
-       if (currentCommand == enet_list_end (& peer -> outgoingCommands))
-         return ENET_PROTOCOL_COMMAND_NONE;
+    outgoingCommand = * link;
 
-       wasSent = 0;
-    }
+    wasSent = outgoingCommand -> inTransit;
 
-    if (outgoingCommand == NULL)
-      return ENET_PROTOCOL_COMMAND_NONE;
+    * link = outgoingCommand -> nextReliableCommand;
 
     if (channelID < peer -> channelCount)
     {
@@ -270,7 +252,7 @@ enet_protocol_remove_sent_reliable_command (ENetPeer * peer, enet_uint16 reliabl
        }
     }
 
-    enet_free (outgoingCommand);
+    enet_pool_free (peer -> host -> outgoingCommandPool, outgoingCommand);
 
     if (enet_list_empty (& peer -> sentReliableCommands))
       return commandNumber;
@@ -338,6 +320,8 @@ enet_protocol_handle_connect (ENetHost * host, ENetProtocolHeader * header, ENet
     peer -> packetThrottleAcceleration = ENET_NET_TO_HOST_32 (command -> connect.packetThrottleAcceleration);
     peer -> packetThrottleDeceleration = ENET_NET_TO_HOST_32 (command -> connect.packetThrottleDeceleration);
     peer -> eventData = ENET_NET_TO_HOST_32 (command -> connect.data);
+    if (host -> acknowledgeRanges && (command -> header.command & ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE_RANGES))
+      peer -> flags |= ENET_PEER_FLAG_ACKNOWLEDGE_RANGES;
 
     incomingSessionID = command -> connect.incomingSessionID == 0xFF ? peer -> outgoingSessionID : command -> connect.incomingSessionID;
     incomingSessionID = (incomingSessionID + 1) & (ENET_PROTOCOL_HEADER_SESSION_MASK >> ENET_PROTOCOL_HEADER_SESSION_SHIFT);
@@ -363,6 +347,14 @@ enet_protocol_handle_connect (ENetHost * host, ENetProtocolHeader * header, ENet
         enet_list_clear (& channel -> incomingReliableCommands);
         enet_list_clear (& channel -> incomingUnreliableCommands);
 
+        channel -> incomingReliableRing = NULL;
+        channel -> incomingReliableSlots = NULL;
+        channel -> incomingReliableOverflow = 0;
+        channel -> sentReliableRing = NULL;
+        channel -> sentReliableOrder = NULL;
+        channel -> sentReliableOrderBegin = 0;
+        channel -> sentReliableOrderEnd = 0;
+
         channel -> usedReliableWindows = 0;
         memset (channel -> reliableWindows, 0, sizeof (channel -> reliableWindows));
     }
@@ -413,6 +405,8 @@ enet_protocol_handle_connect (ENetHost * host, ENetProtocolHeader * header, ENet
       windowSize = ENET_PROTOCOL_MAXIMUM_WINDOW_SIZE;
 
     verifyCommand.header.command = ENET_PROTOCOL_COMMAND_VERIFY_CONNECT | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE;
+    if (peer -> flags & ENET_PEER_FLAG_ACKNOWLEDGE_RANGES)
+      verifyCommand.header.command |= ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE_RANGES;
     verifyCommand.header.channelID = 0xFF;
     verifyCommand.verifyConnect.outgoingPeerID = ENET_HOST_TO_NET_16 (peer -> incomingPeerID);
     verifyCommand.verifyConnect.incomingSessionID = incomingSessionID;
@@ -533,8 +527,7 @@ enet_protocol_handle_send_fragment (ENetHost * host, ENetPeer * peer, const ENet
            totalLength;
     ENetChannel * channel;
     enet_uint16 startWindow, currentWindow;
-    ENetListIterator currentCommand;
-    ENetIncomingCommand * startCommand = NULL;
+    ENetIncomingCommand * startCommand;
 
     if (command -> header.channelID >= peer -> channelCount ||
         (peer -> state != ENET_PEER_STATE_CONNECTED && peer -> state != ENET_PEER_STATE_DISCONNECT_LATER))
@@ -570,36 +563,13 @@ enet_protocol_handle_send_fragment (ENetHost * host, ENetPeer * peer, const ENet
         fragmentLength > totalLength - fragmentOffset)
       return -1;
  
-    for (currentCommand = enet_list_previous (enet_list_end (& channel -> incomingReliableCommands));
-         currentCommand != enet_list_end (& channel -> incomingReliableCommands);
-         currentCommand = enet_list_previous (currentCommand))
-    {
-       ENetIncomingCommand * incomingCommand = (ENetIncomingCommand *) currentCommand;
-
-       if (startSequenceNumber >= channel -> incomingReliableSequenceNumber)
-       {
-          if (incomingCommand -> reliableSequenceNumber < channel -> incomingReliableSequenceNumber)
-            continue;
-       }
-       else
-       if (incomingCommand -> reliableSequenceNumber >= channel -> incomingReliableSequenceNumber)
-         break;
-
-       if (incomingCommand -> reliableSequenceNumber <= startSequenceNumber)
-       {
-          if (incomingCommand -> reliableSequenceNumber < startSequenceNumber)
-            break;
-        
-          if ((incomingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_MASK) != ENET_PROTOCOL_COMMAND_SEND_FRAGMENT ||
-              totalLength != incomingCommand -> packet -> dataLength ||
-              fragmentCount != incomingCommand -> fragmentCount)
-            return -1;
+    startCommand = enet_peer_find_incoming_reliable_command (channel, startSequenceNumber);
+    if (startCommand != NULL &&
+        ((startCommand -> command.header.command & ENET_PROTOCOL_COMMAND_MASK) != ENET_PROTOCOL_COMMAND_SEND_FRAGMENT ||
+         totalLength != startCommand -> packet -> dataLength ||
+         fragmentCount != startCommand -> fragmentCount))
+      return -1;
 
-          startCommand = incomingCommand;
-          break;
-       }
-    }
- 
     if (startCommand == NULL)
     {
        ENetProtocol hostCommand = * command;
@@ -834,13 +804,179 @@ enet_protocol_handle_disconnect (ENetHost * host, ENetPeer * peer, const ENetPro
     return 0;
 }
 
+/* a round trip time sample in microseconds: the local send time of the acknowledged command
+   when it was sent only once, otherwise the millisecond send time the peer echoed back */
+static enet_uint32
+enet_protocol_round_trip_time (ENetHost * host, ENetPeer * peer, const ENetProtocol * command, enet_uint32 echoedRoundTripTime)
+{
+    ENetOutgoingCommand ** link = enet_peer_find_reliable_command (peer, ENET_NET_TO_HOST_16 (command -> acknowledge.receivedReliableSequenceNumber), command -> header.channelID);
+    enet_uint32 roundTripTime = echoedRoundTripTime * 1000;
+
+    if (link != NULL && (* link) -> sendAttempts == 1 && (* link) -> inTransit)
+    {
+       enet_uint32 preciseRoundTripTime = host -> serviceTimeMicroseconds - (* link) -> sentTimeMicroseconds;
+
+       /* the clocks are read at different points, trust the precise sample only within a millisecond of the echo */
+       if (preciseRoundTripTime + 1000 > roundTripTime && preciseRoundTripTime < roundTripTime + 1000)
+         roundTripTime = preciseRoundTripTime;
+    }
+
+    return ENET_MAX (roundTripTime, 1);
+}
+
+/* Resends, without waiting for their round trip timeout, the commands sent before
+   an acknowledged one on its channel that trail it by ENET_PEER_FAST_RETRANSMIT_THRESHOLD
+   or more sequence numbers, or that were sent more than a quarter of a round trip before
+   it, since acknowledgements rarely overtake each other by that much.  The latter rule
+   covers the last few commands of a burst.  The channel keeps the sequence numbers it
+   sent in order, so only its transmissions ahead of the acknowledged one are looked up,
+   and those acknowledged or resent since are dropped from the front as they are passed.
+   A resent command is only resent again once a command sent after it is acknowledged.
+   Only the acknowledgement of a first transmission looks back, as every command still in
+   transit ahead of it trails it, where a resend is sent behind commands it trails. */
+static void
+enet_protocol_fast_retransmit (ENetHost * host, ENetPeer * peer, ENetOutgoingCommand * acknowledgedCommand)
+{
+    ENetChannel * channel;
+    ENetOutgoingCommand * outgoingCommand;
+    ENetOutgoingCommand ** link;
+    ENetListIterator insertPosition;
+    enet_uint16 sentOrder, sequenceDistance;
+
+    if (acknowledgedCommand -> sendAttempts > 1 ||
+        acknowledgedCommand -> command.header.channelID >= peer -> channelCount)
+      return;
+
+    channel = & peer -> channels [acknowledgedCommand -> command.header.channelID];
+    if (channel -> sentReliableOrder == NULL ||
+        (enet_uint16) (acknowledgedCommand -> sentOrder - channel -> sentReliableOrderBegin) >=
+          (enet_uint16) (channel -> sentReliableOrderEnd - channel -> sentReliableOrderBegin))
+      return;
+
+    insertPosition = enet_list_begin (& peer -> outgoingCommands);
+
+    for (sentOrder = channel -> sentReliableOrderBegin;
+         sentOrder != acknowledgedCommand -> sentOrder;
+         ++ sentOrder)
+    {
+       link = enet_peer_find_reliable_command (peer,
+                                               channel -> sentReliableOrder [sentOrder & (ENET_PEER_SENT_RELIABLE_RING_SIZE - 1)],
+                                               acknowledgedCommand -> command.header.channelID);
+       outgoingCommand = link != NULL ? * link : NULL;
+
+       if (outgoingCommand == NULL ||
+           ! outgoingCommand -> inTransit ||
+           outgoingCommand -> sentOrder != sentOrder)
+       {
+          if (sentOrder == channel -> sentReliableOrderBegin)
+            ++ channel -> sentReliableOrderBegin;
+
+          continue;
+       }
+
+       sequenceDistance = acknowledgedCommand -> reliableSequenceNumber - outgoingCommand -> reliableSequenceNumber;
+       if (sequenceDistance == 0 ||
+           sequenceDistance >= 0x8000 ||
+           (sequenceDistance < ENET_PEER_FAST_RETRANSMIT_THRESHOLD &&
+             ENET_TIME_DIFFERENCE (acknowledgedCommand -> sentTime, outgoingCommand -> sentTime) <= peer -> roundTripTime / 4))
+         continue;
+
+       if (sentOrder == channel -> sentReliableOrderBegin)
+         ++ channel -> sentReliableOrderBegin;
+
+       if (outgoingCommand -> packet != NULL)
+         peer -> reliableDataInTransit -= outgoingCommand -> fragmentLength;
+
+       ++ peer -> packetsLost;
+       ++ peer -> fastRetransmits;
+
+       if (host -> congestionControl != ENET_CONGESTION_CONTROL_THROTTLE)
+         enet_peer_congestion_loss (peer);
+
+       outgoingCommand -> inTransit = 0;
+
+       enet_list_insert (insertPosition, enet_list_remove (& outgoingCommand -> outgoingCommandList));
+    }
+}
+
+/* removes one acknowledged command from the sent commands of a peer and
+   advances the state of the peer if it was waiting for that command */
+static int
+enet_protocol_acknowledge_command (ENetHost * host, ENetEvent * event, ENetPeer * peer, enet_uint8 channelID, enet_uint16 reliableSequenceNumber, enet_uint32 receivedSentTime, enet_uint32 roundTripTime)
+{
+    ENetOutgoingCommand ** link;
+    enet_uint32 reliableDataInTransit;
+    ENetProtocolCommand commandNumber;
+
+    if (peer -> mtuProbeSize != 0 &&
+        channelID == 0xFF &&
+        reliableSequenceNumber == peer -> mtuProbeSequenceNumber)
+    {
+       peer -> mtu = peer -> mtuProbeSize;
+       peer -> mtuProbeSize = 0;
+       peer -> mtuProbeTimeout = host -> serviceTime;
+
+       return 0;
+    }
+
+    link = enet_peer_find_reliable_command (peer, reliableSequenceNumber, channelID);
+    if (link != NULL)
+    {
+       /* the acknowledgement answers a transmission from before the command timed out or was resent */
+       if (host -> congestionControl != ENET_CONGESTION_CONTROL_THROTTLE &&
+           ((* link) -> inTransit == 0 ||
+             ((* link) -> sendAttempts > 1 && ENET_TIME_LESS (receivedSentTime, (* link) -> sentTime))))
+         enet_peer_congestion_undo (peer);
+
+       if ((* link) -> inTransit)
+         enet_protocol_fast_retransmit (host, peer, * link);
+    }
+
+    reliableDataInTransit = peer -> reliableDataInTransit;
+
+    commandNumber = enet_protocol_remove_sent_reliable_command (peer, reliableSequenceNumber, channelID);
+
+    if (host -> congestionControl != ENET_CONGESTION_CONTROL_THROTTLE &&
+        peer -> reliableDataInTransit < reliableDataInTransit)
+      enet_peer_congestion_acknowledge (peer, reliableDataInTransit - peer -> reliableDataInTransit, roundTripTime);
+
+    switch (peer -> state)
+    {
+    case ENET_PEER_STATE_ACKNOWLEDGING_CONNECT:
+       if (commandNumber != ENET_PROTOCOL_COMMAND_VERIFY_CONNECT)
+         return -1;
+
+       enet_protocol_notify_connect (host, peer, event);
+       break;
+
+    case ENET_PEER_STATE_DISCONNECTING:
+       if (commandNumber != ENET_PROTOCOL_COMMAND_DISCONNECT)
+         return -1;
+
+       enet_protocol_notify_disconnect (host, peer, event);
+       break;
+
+    case ENET_PEER_STATE_DISCONNECT_LATER:
+       if (enet_list_empty (& peer -> outgoingCommands) &&
+           enet_list_empty (& peer -> sentReliableCommands))
+         enet_peer_disconnect (peer, peer -> eventData);
+       break;
+
+    default:
+       break;
+    }
+   
+    return 0;
+}
+
 static int
 enet_protocol_handle_acknowledge (ENetHost * host, ENetEvent * event, ENetPeer * peer, const ENetProtocol * command)
 {
     enet_uint32 roundTripTime,
            receivedSentTime,
-           receivedReliableSequenceNumber;
-    ENetProtocolCommand commandNumber;
+           receivedReliableSequenceNumber,
+           rangeLength,
+           sequenceNumber;
 
     if (peer -> state == ENET_PEER_STATE_DISCONNECTED || peer -> state == ENET_PEER_STATE_ZOMBIE)
       return 0;
@@ -853,47 +989,50 @@ enet_protocol_handle_acknowledge (ENetHost * host, ENetEvent * event, ENetPeer *
     if (ENET_TIME_LESS (host -> serviceTime, receivedSentTime))
       return 0;
 
-    roundTripTime = ENET_TIME_DIFFERENCE (host -> serviceTime, receivedSentTime);
-    roundTripTime = ENET_MAX (roundTripTime, 1);
+    roundTripTime = enet_protocol_round_trip_time (host, peer, command, ENET_TIME_DIFFERENCE (host -> serviceTime, receivedSentTime));
 
     if (peer -> lastReceiveTime > 0)
     {
        enet_peer_throttle (peer, roundTripTime);
 
-       peer -> roundTripTimeVariance -= peer -> roundTripTimeVariance / 4;
+       peer -> roundTripTimeVarianceMicroseconds -= peer -> roundTripTimeVarianceMicroseconds / 4;
 
-       if (roundTripTime >= peer -> roundTripTime)
+       if (roundTripTime >= peer -> roundTripTimeMicroseconds)
        {
-          enet_uint32 diff = roundTripTime - peer -> roundTripTime;
-          peer -> roundTripTimeVariance += diff / 4;
-          peer -> roundTripTime += diff / 8;
+          enet_uint32 diff = roundTripTime - peer -> roundTripTimeMicroseconds;
+          peer -> roundTripTimeVarianceMicroseconds += diff / 4;
+          peer -> roundTripTimeMicroseconds += diff / 8;
        }
        else
        {
-          enet_uint32 diff = peer -> roundTripTime - roundTripTime;
-          peer -> roundTripTimeVariance += diff / 4;
-          peer -> roundTripTime -= diff / 8;
+          enet_uint32 diff = peer -> roundTripTimeMicroseconds - roundTripTime;
+          peer -> roundTripTimeVarianceMicroseconds += diff / 4;
+          peer -> roundTripTimeMicroseconds -= diff / 8;
        }
     }
     else
     {
-       peer -> roundTripTime = roundTripTime;
-       peer -> roundTripTimeVariance = (roundTripTime + 1) / 2;
+       peer -> roundTripTimeMicroseconds = roundTripTime;
+       peer -> roundTripTimeVarianceMicroseconds = (roundTripTime + 1) / 2;
     }
 
-    if (peer -> roundTripTime < peer -> lowestRoundTripTime)
-      peer -> lowestRoundTripTime = peer -> roundTripTime;
+    peer -> roundTripTime = ENET_MAX ((peer -> roundTripTimeMicroseconds + 999) / 1000, 1);
+    peer -> roundTripTimeVariance = (peer -> roundTripTimeVarianceMicroseconds + 999) / 1000;
+
+    if (peer -> roundTripTimeMicroseconds < peer -> lowestRoundTripTime)
+      peer -> lowestRoundTripTime = peer -> roundTripTimeMicroseconds;
 
-    if (peer -> roundTripTimeVariance > peer -> highestRoundTripTimeVariance)
-      peer -> highestRoundTripTimeVariance = peer -> roundTripTimeVariance;
+    if (peer -> roundTripTimeVarianceMicroseconds > peer -> highestRoundTripTimeVariance)
+      peer -> highestRoundTripTimeVariance = peer -> roundTripTimeVarianceMicroseconds;
 
     if (peer -> packetThrottleEpoch == 0 ||
         ENET_TIME_DIFFERENCE (host -> serviceTime, peer -> packetThrottleEpoch) >= peer -> packetThrottleInterval)
     {
+        /* the throttle was tuned for millisecond samples, so its variance floor stays at one millisecond */
         peer -> lastRoundTripTime = peer -> lowestRoundTripTime;
-        peer -> lastRoundTripTimeVariance = ENET_MAX (peer -> highestRoundTripTimeVariance, 1);
-        peer -> lowestRoundTripTime = peer -> roundTripTime;
-        peer -> highestRoundTripTimeVariance = peer -> roundTripTimeVariance;
+        peer -> lastRoundTripTimeVariance = ENET_MAX (peer -> highestRoundTripTimeVariance, 1000);
+        peer -> lowestRoundTripTime = peer -> roundTripTimeMicroseconds;
+        peer -> highestRoundTripTimeVariance = peer -> roundTripTimeVarianceMicroseconds;
         peer -> packetThrottleEpoch = host -> serviceTime;
     }
 
@@ -902,32 +1041,20 @@ enet_protocol_handle_acknowledge (ENetHost * host, ENetEvent * event, ENetPeer *
 
     receivedReliableSequenceNumber = ENET_NET_TO_HOST_16 (command -> acknowledge.receivedReliableSequenceNumber);
 
-    commandNumber = enet_protocol_remove_sent_reliable_command (peer, receivedReliableSequenceNumber, command -> header.channelID);
+    rangeLength = (command -> header.command & ENET_PROTOCOL_COMMAND_MASK) == ENET_PROTOCOL_COMMAND_ACKNOWLEDGE_RANGE ?
+                    ENET_NET_TO_HOST_16 (command -> acknowledgeRange.rangeLength) : 0;
+    if (rangeLength >= ENET_PEER_RELIABLE_WINDOW_SIZE)
+      return -1;
 
-    switch (peer -> state)
+    for (sequenceNumber = receivedReliableSequenceNumber - rangeLength; ; ++ sequenceNumber)
     {
-    case ENET_PEER_STATE_ACKNOWLEDGING_CONNECT:
-       if (commandNumber != ENET_PROTOCOL_COMMAND_VERIFY_CONNECT)
-         return -1;
-
-       enet_protocol_notify_connect (host, peer, event);
-       break;
-
-    case ENET_PEER_STATE_DISCONNECTING:
-       if (commandNumber != ENET_PROTOCOL_COMMAND_DISCONNECT)
+       if (enet_protocol_acknowledge_command (host, event, peer, command -> header.channelID, (enet_uint16) sequenceNumber, receivedSentTime, roundTripTime))
          return -1;
 
-       enet_protocol_notify_disconnect (host, peer, event);
-       break;
-
-    case ENET_PEER_STATE_DISCONNECT_LATER:
-       if (enet_list_empty (& peer -> outgoingCommands) &&
-           enet_list_empty (& peer -> sentReliableCommands))
-         enet_peer_disconnect (peer, peer -> eventData);
-       break;
-
-    default:
-       break;
+       if ((enet_uint16) sequenceNumber == receivedReliableSequenceNumber ||
+           peer -> state == ENET_PEER_STATE_DISCONNECTED ||
+           peer -> state == ENET_PEER_STATE_ZOMBIE)
+         break;
     }
    
     return 0;
@@ -958,6 +1085,9 @@ enet_protocol_handle_verify_connect (ENetHost * host, ENetEvent * event, ENetPee
     }
 
     enet_protocol_remove_sent_reliable_command (peer, 1, 0xFF);
+
+    if (host -> acknowledgeRanges && (command -> header.command & ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE_RANGES))
+      peer -> flags |= ENET_PEER_FLAG_ACKNOWLEDGE_RANGES;
     
     if (channelCount < peer -> channelCount)
       peer -> channelCount = channelCount;
@@ -1110,6 +1240,7 @@ enet_protocol_handle_incoming_commands (ENetHost * host, ENetEvent * event)
        switch (commandNumber)
        {
        case ENET_PROTOCOL_COMMAND_ACKNOWLEDGE:
+       case ENET_PROTOCOL_COMMAND_ACKNOWLEDGE_RANGE:
           if (enet_protocol_handle_acknowledge (host, event, peer, command))
             goto commandError;
           break;
@@ -1213,23 +1344,70 @@ commandError:
     return 0;
 }
  
+static int
+enet_protocol_receive_datagram (ENetHost * host)
+{
+    int receivedLength;
+    ENetBuffer buffer;
+
+    if (host -> receiveBatchBuffers != NULL)
+    {
+       do
+       {
+          if (host -> receiveBatchIndex >= host -> receiveBatchCount)
+          {
+             int receivedCount = enet_socket_receive_batch (host -> socket,
+                                                            host -> receiveBatchAddresses,
+                                                            host -> receiveBatchBuffers,
+                                                            host -> receiveBatchLengths,
+                                                            host -> receiveBatchSize);
+
+             if (receivedCount <= 0)
+               return receivedCount;
+
+             host -> receiveBatchCount = receivedCount;
+             host -> receiveBatchIndex = 0;
+          }
+
+          host -> receivedAddress = host -> receiveBatchAddresses [host -> receiveBatchIndex];
+          host -> receivedData = (enet_uint8 *) host -> receiveBatchBuffers [host -> receiveBatchIndex].data;
+          receivedLength = (int) host -> receiveBatchLengths [host -> receiveBatchIndex];
+
+          ++ host -> receiveBatchIndex;
+       } while (receivedLength == 0);
+
+       return receivedLength;
+    }
+
+    buffer.data = host -> packetData [0];
+    buffer.dataLength = sizeof (host -> packetData [0]);
+
+    receivedLength = enet_socket_receive (host -> socket,
+                                          & host -> receivedAddress,
+                                          & buffer,
+                                          1);
+
+    if (receivedLength > 0)
+      host -> receivedData = host -> packetData [0];
+
+    return receivedLength;
+}
+
 static int
 enet_protocol_receive_incoming_commands (ENetHost * host, ENetEvent * event)
 {
     int packets;
 
-    for (packets = 0; packets < 256; ++ packets)
+    /* datagrams left over from a batched receive are always handled before returning 0 */
+    for (packets = 0; packets < 256 || host -> receiveBatchIndex < host -> receiveBatchCount; ++ packets)
     {
        int receivedLength;
-       ENetBuffer buffer;
 
-       buffer.data = host -> packetData [0];
-       buffer.dataLength = sizeof (host -> packetData [0]);
+       receivedLength = enet_protocol_receive_datagram (host);
 
-       receivedLength = enet_socket_receive (host -> socket,
-                                             & host -> receivedAddress,
-                                             & buffer,
-                                             1);
+       /* a datagram larger than the receive buffer is dropped */
+       if (receivedLength == -2)
+         continue;
 
        if (receivedLength < 0)
          return -1;
@@ -1237,7 +1415,6 @@ enet_protocol_receive_incoming_commands (ENetHost * host, ENetEvent * event)
        if (receivedLength == 0)
          return 0;
 
-       host -> receivedData = host -> packetData [0];
        host -> receivedDataLength = receivedLength;
       
        host -> totalReceivedData += receivedLength;
@@ -1284,7 +1461,8 @@ enet_protocol_send_acknowledgements (ENetHost * host, ENetPeer * peer)
     ENetBuffer * buffer = & host -> buffers [host -> bufferCount];
     ENetAcknowledgement * acknowledgement;
     ENetListIterator currentAcknowledgement;
-    enet_uint16 reliableSequenceNumber;
+    enet_uint16 reliableSequenceNumber, rangeLength;
+    size_t commandSize = (peer -> flags & ENET_PEER_FLAG_ACKNOWLEDGE_RANGES) ? sizeof (ENetProtocolAcknowledgeRange) : sizeof (ENetProtocolAcknowledge);
  
     currentAcknowledgement = enet_list_begin (& peer -> acknowledgements);
          
@@ -1292,7 +1470,7 @@ enet_protocol_send_acknowledgements (ENetHost * host, ENetPeer * peer)
     {
        if (command >= & host -> commands [sizeof (host -> commands) / sizeof (ENetProtocol)] ||
            buffer >= & host -> buffers [sizeof (host -> buffers) / sizeof (ENetBuffer)] ||
-           peer -> mtu - host -> packetSize < sizeof (ENetProtocolAcknowledge))
+           peer -> mtu - host -> packetSize < commandSize)
        {
           host -> continueSending = 1;
 
@@ -1303,24 +1481,52 @@ enet_protocol_send_acknowledgements (ENetHost * host, ENetPeer * peer)
  
        currentAcknowledgement = enet_list_next (currentAcknowledgement);
 
+       /* fold the acknowledgements of following sequence numbers on the same channel into a range */
+       rangeLength = 0;
+       if (peer -> flags & ENET_PEER_FLAG_ACKNOWLEDGE_RANGES)
+       {
+          while (currentAcknowledgement != enet_list_end (& peer -> acknowledgements) &&
+                 rangeLength < ENET_PEER_RELIABLE_WINDOW_SIZE - 1)
+          {
+             ENetAcknowledgement * nextAcknowledgement = (ENetAcknowledgement *) currentAcknowledgement;
+
+             if (nextAcknowledgement -> command.header.channelID != acknowledgement -> command.header.channelID ||
+                 nextAcknowledgement -> command.header.reliableSequenceNumber != (enet_uint16) (acknowledgement -> command.header.reliableSequenceNumber + 1))
+               break;
+
+             if ((acknowledgement -> command.header.command & ENET_PROTOCOL_COMMAND_MASK) == ENET_PROTOCOL_COMMAND_DISCONNECT)
+               enet_protocol_dispatch_state (host, peer, ENET_PEER_STATE_ZOMBIE);
+
+             enet_list_remove (& acknowledgement -> acknowledgementList);
+             enet_pool_free (host -> acknowledgementPool, acknowledgement);
+
+             acknowledgement = nextAcknowledgement;
+             currentAcknowledgement = enet_list_next (currentAcknowledgement);
+
+             ++ rangeLength;
+          }
+       }
+
        buffer -> data = command;
-       buffer -> dataLength = sizeof (ENetProtocolAcknowledge);
+       buffer -> dataLength = rangeLength > 0 ? sizeof (ENetProtocolAcknowledgeRange) : sizeof (ENetProtocolAcknowledge);
 
        host -> packetSize += buffer -> dataLength;
 
        reliableSequenceNumber = ENET_HOST_TO_NET_16 (acknowledgement -> command.header.reliableSequenceNumber);
   
-       command -> header.command = ENET_PROTOCOL_COMMAND_ACKNOWLEDGE;
+       command -> header.command = rangeLength > 0 ? ENET_PROTOCOL_COMMAND_ACKNOWLEDGE_RANGE : ENET_PROTOCOL_COMMAND_ACKNOWLEDGE;
        command -> header.channelID = acknowledgement -> command.header.channelID;
        command -> header.reliableSequenceNumber = reliableSequenceNumber;
        command -> acknowledge.receivedReliableSequenceNumber = reliableSequenceNumber;
        command -> acknowledge.receivedSentTime = ENET_HOST_TO_NET_16 (acknowledgement -> sentTime);
+       if (rangeLength > 0)
+         command -> acknowledgeRange.rangeLength = ENET_HOST_TO_NET_16 (rangeLength);
   
        if ((acknowledgement -> command.header.command & ENET_PROTOCOL_COMMAND_MASK) == ENET_PROTOCOL_COMMAND_DISCONNECT)
          enet_protocol_dispatch_state (host, peer, ENET_PEER_STATE_ZOMBIE);
 
        enet_list_remove (& acknowledgement -> acknowledgementList);
-       enet_free (acknowledgement);
+       enet_pool_free (host -> acknowledgementPool, acknowledgement);
 
        ++ command;
        ++ buffer;
@@ -1366,8 +1572,13 @@ enet_protocol_check_timeouts (ENetHost * host, ENetPeer * peer, ENetEvent * even
          peer -> reliableDataInTransit -= outgoingCommand -> fragmentLength;
           
        ++ peer -> packetsLost;
+       ++ peer -> timeoutRetransmits;
+
+       if (host -> congestionControl != ENET_CONGESTION_CONTROL_THROTTLE)
+         enet_peer_congestion_loss (peer);
 
        outgoingCommand -> roundTripTimeout *= 2;
+       outgoingCommand -> inTransit = 0;
 
        enet_list_insert (insertPosition, enet_list_remove (& outgoingCommand -> outgoingCommandList));
 
@@ -1426,8 +1637,13 @@ enet_protocol_check_outgoing_commands (ENetHost * host, ENetPeer * peer)
           {
              if (! windowExceeded)
              {
-                enet_uint32 windowSize = (peer -> packetThrottle * peer -> windowSize) / ENET_PEER_PACKET_THROTTLE_SCALE;
-             
+                enet_uint32 windowSize;
+
+                if (host -> congestionControl != ENET_CONGESTION_CONTROL_THROTTLE)
+                  windowSize = peer -> congestionWindow;
+                else
+                  windowSize = (peer -> packetThrottle * peer -> windowSize) / ENET_PEER_PACKET_THROTTLE_SCALE;
+
                 if (peer -> reliableDataInTransit + outgoingCommand -> fragmentLength > ENET_MAX (windowSize, peer -> mtu))
                   windowExceeded = 1;
              }
@@ -1458,10 +1674,15 @@ enet_protocol_check_outgoing_commands (ENetHost * host, ENetPeer * peer)
 
        if (outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE)
        {
-          if (channel != NULL && outgoingCommand -> sendAttempts < 1)
+          if (outgoingCommand -> sendAttempts < 1)
           {
-             channel -> usedReliableWindows |= 1 << reliableWindow;
-             ++ channel -> reliableWindows [reliableWindow];
+             if (channel != NULL)
+             {
+                channel -> usedReliableWindows |= 1 << reliableWindow;
+                ++ channel -> reliableWindows [reliableWindow];
+             }
+
+             enet_peer_link_reliable_command (peer, outgoingCommand);
           }
 
           ++ outgoingCommand -> sendAttempts;
@@ -1478,7 +1699,20 @@ enet_protocol_check_outgoing_commands (ENetHost * host, ENetPeer * peer)
           enet_list_insert (enet_list_end (& peer -> sentReliableCommands),
                             enet_list_remove (& outgoingCommand -> outgoingCommandList));
 
+          outgoingCommand -> inTransit = 1;
+
+          if (channel != NULL && channel -> sentReliableOrder != NULL)
+          {
+             /* the oldest transmission of an overflowing order is left to its round trip timeout */
+             if ((enet_uint16) (channel -> sentReliableOrderEnd - channel -> sentReliableOrderBegin) >= ENET_PEER_SENT_RELIABLE_RING_SIZE)
+               ++ channel -> sentReliableOrderBegin;
+
+             outgoingCommand -> sentOrder = channel -> sentReliableOrderEnd ++;
+             channel -> sentReliableOrder [outgoingCommand -> sentOrder & (ENET_PEER_SENT_RELIABLE_RING_SIZE - 1)] = outgoingCommand -> reliableSequenceNumber;
+          }
+
           outgoingCommand -> sentTime = host -> serviceTime;
+          outgoingCommand -> sentTimeMicroseconds = host -> serviceTimeMicroseconds;
 
           host -> headerFlags |= ENET_PROTOCOL_HEADER_FLAG_SENT_TIME;
 
@@ -1503,7 +1737,7 @@ enet_protocol_check_outgoing_commands (ENetHost * host, ENetPeer * peer)
                      enet_packet_destroy (outgoingCommand -> packet);
 
                    enet_list_remove (& outgoingCommand -> outgoingCommandList);
-                   enet_free (outgoingCommand);
+                   enet_pool_free (host -> outgoingCommandPool, outgoingCommand);
 
                    if (currentCommand == enet_list_end (& peer -> outgoingCommands))
                      break;
@@ -1544,7 +1778,7 @@ enet_protocol_check_outgoing_commands (ENetHost * host, ENetPeer * peer)
        }
        else
        if (! (outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE))
-         enet_free (outgoingCommand);
+         enet_pool_free (host -> outgoingCommandPool, outgoingCommand);
 
        ++ peer -> packetsSent;
         
@@ -1564,16 +1798,180 @@ enet_protocol_check_outgoing_commands (ENetHost * host, ENetPeer * peer)
     return canPing;
 }
 
+static int
+enet_protocol_flush_datagrams (ENetHost * host)
+{
+    int sentCount;
+
+    if (host -> sendBatchCount == 0)
+      return 0;
+
+    sentCount = enet_socket_send_batch (host -> socket,
+                                        host -> sendBatchAddresses,
+                                        host -> sendBatchBuffers,
+                                        host -> sendBatchCount,
+                                        & host -> sendBatchSegmentation);
+
+    host -> sendBatchCount = 0;
+
+    return sentCount < 0 ? -1 : 0;
+}
+
+static int
+enet_protocol_queue_datagram (ENetHost * host, const ENetAddress * address)
+{
+    ENetBuffer * datagram = & host -> sendBatchBuffers [host -> sendBatchCount];
+    enet_uint8 * data = (enet_uint8 *) datagram -> data;
+    size_t bufferIndex;
+
+    for (bufferIndex = 0; bufferIndex < host -> bufferCount; ++ bufferIndex)
+    {
+       memcpy (data, host -> buffers [bufferIndex].data, host -> buffers [bufferIndex].dataLength);
+
+       data += host -> buffers [bufferIndex].dataLength;
+    }
+
+    datagram -> dataLength = data - (enet_uint8 *) datagram -> data;
+    host -> sendBatchAddresses [host -> sendBatchCount] = * address;
+
+    if (++ host -> sendBatchCount >= host -> sendBatchSize &&
+        enet_protocol_flush_datagrams (host) < 0)
+      return -1;
+
+    return (int) datagram -> dataLength;
+}
+
+/* A probe is an acknowledged ping padded with zeros, which end the command list
+   of the datagram, to the size being probed.  It is sent outside the outgoing
+   queue so that it is never resent at another size.  Sizes are bisected between
+   the MTU known to get through and the largest not yet ruled out. */
+static void
+enet_protocol_probe_mtu (ENetHost * host, ENetPeer * peer)
+{
+    static const enet_uint8 padding [ENET_PROTOCOL_MAXIMUM_MTU] = { 0 };
+    enet_uint8 headerData [sizeof (ENetProtocolHeader) + sizeof (enet_uint32)];
+    ENetProtocolHeader * header = (ENetProtocolHeader *) headerData;
+    ENetProtocol command;
+    ENetBuffer buffers [3];
+    enet_uint16 headerFlags = ENET_PROTOCOL_HEADER_FLAG_SENT_TIME;
+    enet_uint32 timeout;
+
+    if (peer -> mtuProbeSize != 0 && peer -> mtuProbeAttempts >= ENET_PEER_MTU_PROBE_ATTEMPTS)
+    {
+       peer -> mtuProbeLimit = peer -> mtuProbeSize - 1;
+       peer -> mtuProbeSize = 0;
+    }
+
+    if (peer -> mtuProbeSize == 0)
+    {
+       if (peer -> mtuProbeLimit < peer -> mtu + ENET_PEER_MTU_PROBE_GRANULARITY)
+       {
+          peer -> mtuProbeLimit = 0;
+          return;
+       }
+
+       peer -> mtuProbeSize = peer -> mtu + (peer -> mtuProbeLimit - peer -> mtu + 1) / 2;
+       peer -> mtuProbeSequenceNumber = ++ peer -> outgoingReliableSequenceNumber;
+       peer -> mtuProbeAttempts = 0;
+    }
+
+    ++ peer -> mtuProbeAttempts;
+
+    if (peer -> outgoingPeerID < ENET_PROTOCOL_MAXIMUM_PEER_ID)
+      headerFlags |= peer -> outgoingSessionID << ENET_PROTOCOL_HEADER_SESSION_SHIFT;
+    header -> peerID = ENET_HOST_TO_NET_16 (peer -> outgoingPeerID | headerFlags);
+    header -> sentTime = ENET_HOST_TO_NET_16 (host -> serviceTime & 0xFFFF);
+
+    command.header.command = ENET_PROTOCOL_COMMAND_PING | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE;
+    command.header.channelID = 0xFF;
+    command.header.reliableSequenceNumber = ENET_HOST_TO_NET_16 (peer -> mtuProbeSequenceNumber);
+
+    buffers [0].data = headerData;
+    buffers [0].dataLength = sizeof (ENetProtocolHeader);
+    buffers [1].data = & command;
+    buffers [1].dataLength = sizeof (ENetProtocolPing);
+    buffers [2].data = (void *) padding;
+    buffers [2].dataLength = peer -> mtuProbeSize - sizeof (ENetProtocolHeader) - sizeof (ENetProtocolPing);
+
+    if (host -> checksum != NULL)
+    {
+        enet_uint32 * checksum = (enet_uint32 *) & headerData [sizeof (ENetProtocolHeader)];
+        * checksum = peer -> outgoingPeerID < ENET_PROTOCOL_MAXIMUM_PEER_ID ? peer -> connectID : 0;
+        buffers [0].dataLength += sizeof (enet_uint32);
+        buffers [2].dataLength -= sizeof (enet_uint32);
+        * checksum = host -> checksum (buffers, 3);
+    }
+
+    timeout = ENET_MAX (peer -> roundTripTime + 4 * peer -> roundTripTimeVariance, ENET_PEER_MTU_PROBE_MINIMUM_TIMEOUT);
+
+    if (enet_socket_send (host -> socket, & peer -> address, buffers, 3) < 0)
+    {
+        /* larger than the interface lets through, no point in trying again */
+        peer -> mtuProbeAttempts = ENET_PEER_MTU_PROBE_ATTEMPTS;
+        timeout = 0;
+    }
+    else
+    {
+        host -> totalSentData += peer -> mtuProbeSize;
+        host -> totalSentPackets ++;
+    }
+
+    peer -> mtuProbeTimeout = host -> serviceTime + timeout;
+}
+
+#define ENET_PEER_PACING_GAIN            1.25
+#define ENET_PEER_PACING_SLOW_START_GAIN 2.0
+
+/* Refills the token bucket of a peer at its window per round trip time, with some
+   headroom so that pacing does not keep the window from growing, and tells whether
+   a datagram of commands may be sent to it now.  If not, the host's pacing timeout
+   is brought forward to when the bucket will hold a full datagram. */
+static int
+enet_protocol_pace_peer (ENetHost * host, ENetPeer * peer)
+{
+    enet_uint32 window, burst, delay, deadline;
+    double rate, tokens;
+
+    if (host -> congestionControl != ENET_CONGESTION_CONTROL_THROTTLE)
+    {
+        window = peer -> congestionWindow;
+        rate = window * (window < peer -> congestionThreshold ? ENET_PEER_PACING_SLOW_START_GAIN : ENET_PEER_PACING_GAIN);
+    }
+    else
+    {
+        window = ENET_MAX ((peer -> packetThrottle * peer -> windowSize) / ENET_PEER_PACKET_THROTTLE_SCALE, peer -> mtu);
+        rate = window * ENET_PEER_PACING_GAIN;
+    }
+    rate /= ENET_MAX (peer -> roundTripTimeMicroseconds, 1000);
+
+    burst = ENET_MAX (ENET_PEER_PACING_BURST * peer -> mtu, (enet_uint32) (rate * ENET_PEER_PACING_INTERVAL));
+
+    tokens = peer -> pacingTokens + rate * (enet_uint32) (host -> serviceTimeMicroseconds - peer -> pacingTimeMicroseconds);
+    peer -> pacingTokens = tokens < burst ? (enet_uint32) tokens : burst;
+    peer -> pacingTimeMicroseconds = host -> serviceTimeMicroseconds;
+
+    if (peer -> pacingTokens >= peer -> mtu)
+      return 1;
+
+    delay = (enet_uint32) ((peer -> mtu - peer -> pacingTokens) / rate) + 1;
+    deadline = host -> serviceTime + (delay + 999) / 1000;
+    if (host -> pacingTimeout == 0 || ENET_TIME_LESS (deadline, host -> pacingTimeout))
+      host -> pacingTimeout = deadline;
+
+    return 0;
+}
+
 static int
 enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int checkForTimeouts)
 {
     enet_uint8 headerData [sizeof (ENetProtocolHeader) + sizeof (enet_uint32)];
     ENetProtocolHeader * header = (ENetProtocolHeader *) headerData;
     ENetPeer * currentPeer;
-    int sentLength;
+    int sentLength, paced;
     size_t shouldCompress = 0;
  
     host -> continueSending = 1;
+    host -> pacingTimeout = 0;
 
     while (host -> continueSending)
     for (host -> continueSending = 0,
@@ -1585,6 +1983,11 @@ enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int ch
             currentPeer -> state == ENET_PEER_STATE_ZOMBIE)
           continue;
 
+        if (currentPeer -> mtuProbeLimit != 0 &&
+            currentPeer -> state == ENET_PEER_STATE_CONNECTED &&
+            ENET_TIME_GREATER_EQUAL (host -> serviceTime, currentPeer -> mtuProbeTimeout))
+          enet_protocol_probe_mtu (host, currentPeer);
+
         host -> headerFlags = 0;
         host -> commandCount = 0;
         host -> bufferCount = 1;
@@ -1599,12 +2002,23 @@ enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int ch
             enet_protocol_check_timeouts (host, currentPeer, event) == 1)
         {
             if (event != NULL && event -> type != ENET_EVENT_TYPE_NONE)
-              return 1;
+            {
+                if (enet_protocol_flush_datagrams (host) < 0)
+                  return -1;
+
+                return 1;
+            }
             else
               continue;
         }
 
-        if ((enet_list_empty (& currentPeer -> outgoingCommands) ||
+        /* a peer held back by pacing is still sent its acknowledgements */
+        paced = host -> pacing &&
+                ! enet_list_empty (& currentPeer -> outgoingCommands) &&
+                ! enet_protocol_pace_peer (host, currentPeer);
+
+        if (! paced &&
+            (enet_list_empty (& currentPeer -> outgoingCommands) ||
               enet_protocol_check_outgoing_commands (host, currentPeer)) &&
             enet_list_empty (& currentPeer -> sentReliableCommands) &&
             ENET_TIME_DIFFERENCE (host -> serviceTime, currentPeer -> lastReceiveTime) >= currentPeer -> pingInterval &&
@@ -1686,18 +2100,24 @@ enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int ch
 
         currentPeer -> lastSendTime = host -> serviceTime;
 
-        sentLength = enet_socket_send (host -> socket, & currentPeer -> address, host -> buffers, host -> bufferCount);
+        if (host -> sendBatchBuffers != NULL)
+          sentLength = enet_protocol_queue_datagram (host, & currentPeer -> address);
+        else
+          sentLength = enet_socket_send (host -> socket, & currentPeer -> address, host -> buffers, host -> bufferCount);
 
         enet_protocol_remove_sent_unreliable_commands (currentPeer);
 
         if (sentLength < 0)
           return -1;
 
+        if (host -> pacing)
+          currentPeer -> pacingTokens -= ENET_MIN ((enet_uint32) sentLength, currentPeer -> pacingTokens);
+
         host -> totalSentData += sentLength;
         host -> totalSentPackets ++;
     }
    
-    return 0;
+    return enet_protocol_flush_datagrams (host);
 }
 
 /** Sends any queued packets on the host specified to its designated peers.
@@ -1709,7 +2129,7 @@ enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int ch
 void
 enet_host_flush (ENetHost * host)
 {
-    host -> serviceTime = enet_time_get ();
+    host -> serviceTime = enet_time_get_precise (& host -> serviceTimeMicroseconds);
 
     enet_protocol_send_outgoing_commands (host, NULL, 0);
 }
@@ -1776,7 +2196,7 @@ enet_host_service (ENetHost * host, ENetEvent * event, enet_uint32 timeout)
         }
     }
 
-    host -> serviceTime = enet_time_get ();
+    host -> serviceTime = enet_time_get_precise (& host -> serviceTimeMicroseconds);
     
     timeout += host -> serviceTime;
 
@@ -1857,21 +2277,91 @@ enet_host_service (ENetHost * host, ENetEvent * event, enet_uint32 timeout)
 
        do
        {
-          host -> serviceTime = enet_time_get ();
+          enet_uint32 waitTimeout;
+
+          host -> serviceTime = enet_time_get_precise (& host -> serviceTimeMicroseconds);
 
           if (ENET_TIME_GREATER_EQUAL (host -> serviceTime, timeout))
             return 0;
 
+          waitTimeout = ENET_TIME_DIFFERENCE (timeout, host -> serviceTime);
+          if (host -> pacingTimeout != 0 && ENET_TIME_LESS (host -> pacingTimeout, timeout))
+            waitTimeout = ENET_TIME_LESS (host -> serviceTime, host -> pacingTimeout) ? ENET_TIME_DIFFERENCE (host -> pacingTimeout, host -> serviceTime) : 0;
+
           waitCondition = ENET_SOCKET_WAIT_RECEIVE | ENET_SOCKET_WAIT_INTERRUPT;
 
-          if (enet_socket_wait (host -> socket, & waitCondition, ENET_TIME_DIFFERENCE (timeout, host -> serviceTime)) != 0)
+          if (enet_socket_wait (host -> socket, & waitCondition, waitTimeout) != 0)
             return -1;
        }
        while (waitCondition & ENET_SOCKET_WAIT_INTERRUPT);
 
-       host -> serviceTime = enet_time_get ();
-    } while (waitCondition & ENET_SOCKET_WAIT_RECEIVE);
+       host -> serviceTime = enet_time_get_precise (& host -> serviceTimeMicroseconds);
+    } while ((waitCondition & ENET_SOCKET_WAIT_RECEIVE) ||
+             (host -> pacingTimeout != 0 && ENET_TIME_GREATER_EQUAL (host -> serviceTime, host -> pacingTimeout)));
 
     return 0; 
 }
 
+static void
+enet_protocol_limit_timeout (enet_uint32 * timeout, enet_uint32 timeCurrent, enet_uint32 deadline)
+{
+    if (ENET_TIME_LESS_EQUAL (deadline, timeCurrent))
+      * timeout = 0;
+    else
+    if (ENET_TIME_DIFFERENCE (deadline, timeCurrent) < * timeout)
+      * timeout = ENET_TIME_DIFFERENCE (deadline, timeCurrent);
+}
+
+/** Computes how long the host specified may be left alone before it has
+    timed work to do, so that one thread can wait on the sockets of many
+    hosts and only service those that are readable or due.
+
+    @param host           host to examine
+    @param maximumTimeout upper bound of the returned timeout
+    @returns the number of milliseconds until the next resend timeout, keep
+             alive ping, MTU probe, paced send or bandwidth throttle of the host, 0 if events are
+             waiting to be dispatched or acknowledgements to be sent
+    @remarks incoming datagrams are not accounted for, the host socket should
+             be waited on for readability for at most the returned timeout
+    @ingroup host
+*/
+enet_uint32
+enet_host_service_timeout (ENetHost * host, enet_uint32 maximumTimeout)
+{
+    enet_uint32 timeCurrent = enet_time_get (),
+                timeout = maximumTimeout;
+    ENetPeer * currentPeer;
+
+    if (! enet_list_empty (& host -> dispatchQueue))
+      return 0;
+
+    if (host -> incomingBandwidth != 0 || host -> outgoingBandwidth != 0 || host -> recalculateBandwidthLimits)
+      enet_protocol_limit_timeout (& timeout, timeCurrent, host -> bandwidthThrottleEpoch + ENET_HOST_BANDWIDTH_THROTTLE_INTERVAL);
+
+    for (currentPeer = host -> peers;
+         currentPeer < & host -> peers [host -> peerCount] && timeout > 0;
+         ++ currentPeer)
+    {
+        if (currentPeer -> state == ENET_PEER_STATE_DISCONNECTED ||
+            currentPeer -> state == ENET_PEER_STATE_ZOMBIE)
+          continue;
+
+        if (! enet_list_empty (& currentPeer -> acknowledgements))
+          return 0;
+
+        if (! enet_list_empty (& currentPeer -> sentReliableCommands))
+          enet_protocol_limit_timeout (& timeout, timeCurrent, currentPeer -> nextTimeout);
+        else
+        if (currentPeer -> state == ENET_PEER_STATE_CONNECTED)
+          enet_protocol_limit_timeout (& timeout, timeCurrent, currentPeer -> lastReceiveTime + currentPeer -> pingInterval);
+
+        if (currentPeer -> mtuProbeLimit != 0 && currentPeer -> state == ENET_PEER_STATE_CONNECTED)
+          enet_protocol_limit_timeout (& timeout, timeCurrent, currentPeer -> mtuProbeTimeout);
+    }
+
+    if (host -> pacingTimeout != 0)
+      enet_protocol_limit_timeout (& timeout, timeCurrent, host -> pacingTimeout);
+
+    return timeout;
+}
+
@@ -4,6 +4,10 @@
 */
 #ifndef _WIN32
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE 1
+#endif
+
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
@@ -45,6 +49,38 @@
 #endif
 #endif
 
+#ifdef __linux__
+#ifndef HAS_POLL
+#define HAS_POLL 1
+#endif
+#ifndef HAS_MSGHDR_FLAGS
+#define HAS_MSGHDR_FLAGS 1
+#endif
+#ifndef HAS_EPOLL
+#define HAS_EPOLL 1
+#endif
+#ifndef HAS_RECVMMSG
+#define HAS_RECVMMSG 1
+#endif
+#ifndef HAS_SENDMMSG
+#define HAS_SENDMMSG 1
+#endif
+#endif
+
+#ifdef HAS_SENDMMSG
+#include <netinet/in.h>
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_MAX_SEGMENTS
+#define UDP_MAX_SEGMENTS 64
+#endif
+#define ENET_UDP_MAXIMUM_SEGMENTS_SIZE 65000
+#endif
+
 #ifdef HAS_FCNTL
 #include <fcntl.h>
 #endif
@@ -53,6 +89,11 @@
 #include <poll.h>
 #endif
 
+#ifdef HAS_EPOLL
+#include <sys/epoll.h>
+#define ENET_SOCKET_WAITER_MAXIMUM_EVENTS 64
+#endif
+
 #if !defined(HAS_SOCKLEN_T) && !defined(__socklen_t_defined)
 typedef int socklen_t;
 #endif
@@ -66,6 +107,8 @@ static enet_uint32 timeBase = 0;
 int
 enet_initialize (void)
 {
+    enet_crc32_initialize ();
+
     return 0;
 }
 
@@ -80,24 +123,55 @@ enet_host_random_seed (void)
     return (enet_uint32) time (NULL);
 }
 
-enet_uint32
-enet_time_get (void)
+/* a monotonic clock where available, so that wall-clock steps do not time out peers */
+static void
+enet_time_now (enet_uint32 * milliseconds, enet_uint32 * microseconds)
 {
+#ifdef CLOCK_MONOTONIC
+    struct timespec timeSpec;
+
+    clock_gettime (CLOCK_MONOTONIC, & timeSpec);
+
+    * milliseconds = (enet_uint32) timeSpec.tv_sec * 1000 + (enet_uint32) (timeSpec.tv_nsec / 1000000);
+    * microseconds = (enet_uint32) timeSpec.tv_sec * 1000000 + (enet_uint32) (timeSpec.tv_nsec / 1000);
+#else
     struct timeval timeVal;
 
     gettimeofday (& timeVal, NULL);
 
-    return timeVal.tv_sec * 1000 + timeVal.tv_usec / 1000 - timeBase;
+    * milliseconds = (enet_uint32) timeVal.tv_sec * 1000 + (enet_uint32) (timeVal.tv_usec / 1000);
+    * microseconds = (enet_uint32) timeVal.tv_sec * 1000000 + (enet_uint32) timeVal.tv_usec;
+#endif
+}
+
+enet_uint32
+enet_time_get (void)
+{
+    enet_uint32 milliseconds, microseconds;
+
+    enet_time_now (& milliseconds, & microseconds);
+
+    return milliseconds - timeBase;
+}
+
+enet_uint32
+enet_time_get_precise (enet_uint32 * microseconds)
+{
+    enet_uint32 milliseconds;
+
+    enet_time_now (& milliseconds, microseconds);
+
+    return milliseconds - timeBase;
 }
 
 void
 enet_time_set (enet_uint32 newTimeBase)
 {
-    struct timeval timeVal;
+    enet_uint32 milliseconds, microseconds;
 
-    gettimeofday (& timeVal, NULL);
+    enet_time_now (& milliseconds, & microseconds);
     
-    timeBase = timeVal.tv_sec * 1000 + timeVal.tv_usec / 1000 - newTimeBase;
+    timeBase = milliseconds - newTimeBase;
 }
 
 int
@@ -349,6 +423,16 @@ enet_socket_set_option (ENetSocket socket, ENetSocketOption option, int value)
             result = setsockopt (socket, IPPROTO_TCP, TCP_NODELAY, (char *) & value, sizeof (int));
             break;
 
+        case ENET_SOCKOPT_DONTFRAGMENT:
+#if defined (IP_MTU_DISCOVER) && defined (IP_PMTUDISC_PROBE)
+            /* probe sets the DF bit without clamping sends to the cached path MTU */
+            value = value ? IP_PMTUDISC_PROBE : IP_PMTUDISC_WANT;
+            result = setsockopt (socket, IPPROTO_IP, IP_MTU_DISCOVER, (char *) & value, sizeof (int));
+#elif defined (IP_DONTFRAG)
+            result = setsockopt (socket, IPPROTO_IP, IP_DONTFRAG, (char *) & value, sizeof (int));
+#endif
+            break;
+
         default:
             break;
     }
@@ -501,7 +585,7 @@ enet_socket_receive (ENetSocket socket,
 
 #ifdef HAS_MSGHDR_FLAGS
     if (msgHdr.msg_flags & MSG_TRUNC)
-      return -1;
+      return -2;
 #endif
 
     if (address != NULL)
@@ -513,6 +597,220 @@ enet_socket_receive (ENetSocket socket,
     return recvLength;
 }
 
+int
+enet_socket_receive_batch (ENetSocket socket,
+                           ENetAddress * addresses,
+                           ENetBuffer * buffers,
+                           size_t * receivedLengths,
+                           size_t bufferCount)
+{
+#ifdef HAS_RECVMMSG
+    struct mmsghdr msgHdrs [ENET_HOST_MAXIMUM_BATCH_SIZE];
+    struct sockaddr_in sins [ENET_HOST_MAXIMUM_BATCH_SIZE];
+    int recvCount, recvIndex;
+    size_t bufferIndex;
+
+    if (bufferCount > ENET_HOST_MAXIMUM_BATCH_SIZE)
+      bufferCount = ENET_HOST_MAXIMUM_BATCH_SIZE;
+
+    memset (msgHdrs, 0, sizeof (struct mmsghdr) * bufferCount);
+
+    for (bufferIndex = 0; bufferIndex < bufferCount; ++ bufferIndex)
+    {
+        if (addresses != NULL)
+        {
+            msgHdrs [bufferIndex].msg_hdr.msg_name = & sins [bufferIndex];
+            msgHdrs [bufferIndex].msg_hdr.msg_namelen = sizeof (struct sockaddr_in);
+        }
+
+        msgHdrs [bufferIndex].msg_hdr.msg_iov = (struct iovec *) & buffers [bufferIndex];
+        msgHdrs [bufferIndex].msg_hdr.msg_iovlen = 1;
+    }
+
+    recvCount = recvmmsg (socket, msgHdrs, bufferCount, MSG_NOSIGNAL, NULL);
+
+    if (recvCount == -1)
+    {
+       if (errno == EWOULDBLOCK)
+         return 0;
+
+       return -1;
+    }
+
+    for (recvIndex = 0; recvIndex < recvCount; ++ recvIndex)
+    {
+        receivedLengths [recvIndex] = msgHdrs [recvIndex].msg_len;
+
+#ifdef HAS_MSGHDR_FLAGS
+        /* an oversized datagram is dropped alone, the others of the batch are already taken from the socket */
+        if (msgHdrs [recvIndex].msg_hdr.msg_flags & MSG_TRUNC)
+          receivedLengths [recvIndex] = 0;
+#endif
+
+        if (addresses != NULL)
+        {
+            addresses [recvIndex].host = (enet_uint32) sins [recvIndex].sin_addr.s_addr;
+            addresses [recvIndex].port = ENET_NET_TO_HOST_16 (sins [recvIndex].sin_port);
+        }
+    }
+
+    return recvCount;
+#else
+    size_t bufferIndex;
+
+    for (bufferIndex = 0; bufferIndex < bufferCount; ++ bufferIndex)
+    {
+        int recvLength = enet_socket_receive (socket, addresses != NULL ? & addresses [bufferIndex] : NULL, & buffers [bufferIndex], 1);
+
+        if (recvLength == -2)
+        {
+            receivedLengths [bufferIndex] = 0;
+            continue;
+        }
+
+        if (recvLength < 0)
+          return bufferIndex > 0 ? (int) bufferIndex : -1;
+
+        if (recvLength == 0)
+          break;
+
+        receivedLengths [bufferIndex] = recvLength;
+    }
+
+    return (int) bufferIndex;
+#endif
+}
+
+int
+enet_socket_send_batch (ENetSocket socket,
+                        const ENetAddress * addresses,
+                        const ENetBuffer * buffers,
+                        size_t bufferCount,
+                        int * segmentation)
+{
+#ifdef HAS_SENDMMSG
+    struct mmsghdr msgHdrs [ENET_HOST_MAXIMUM_BATCH_SIZE];
+    struct sockaddr_in sins [ENET_HOST_MAXIMUM_BATCH_SIZE];
+    union
+    {
+        char data [CMSG_SPACE (sizeof (enet_uint16))];
+        struct cmsghdr header;
+    } controls [ENET_HOST_MAXIMUM_BATCH_SIZE];
+    size_t segmentCounts [ENET_HOST_MAXIMUM_BATCH_SIZE];
+    size_t msgCount = 0, msgIndex = 0, bufferIndex = 0, sentBuffers = 0;
+    int useSegmentation = segmentation != NULL && * segmentation;
+
+    if (bufferCount > ENET_HOST_MAXIMUM_BATCH_SIZE)
+      bufferCount = ENET_HOST_MAXIMUM_BATCH_SIZE;
+
+    memset (msgHdrs, 0, sizeof (struct mmsghdr) * bufferCount);
+
+    while (bufferIndex < bufferCount)
+    {
+        const ENetAddress * address = & addresses [bufferIndex];
+        struct msghdr * msgHdr = & msgHdrs [msgCount].msg_hdr;
+        size_t segmentSize = buffers [bufferIndex].dataLength,
+               segmentCount = 1,
+               totalSize = segmentSize;
+
+        /* a run of datagrams to one peer where all but the last have the same size can be one GSO send */
+        if (useSegmentation)
+        {
+            while (bufferIndex + segmentCount < bufferCount &&
+                   segmentCount < UDP_MAX_SEGMENTS &&
+                   buffers [bufferIndex + segmentCount - 1].dataLength == segmentSize &&
+                   buffers [bufferIndex + segmentCount].dataLength <= segmentSize &&
+                   buffers [bufferIndex + segmentCount].dataLength > 0 &&
+                   totalSize + buffers [bufferIndex + segmentCount].dataLength <= ENET_UDP_MAXIMUM_SEGMENTS_SIZE &&
+                   addresses [bufferIndex + segmentCount].host == address -> host &&
+                   addresses [bufferIndex + segmentCount].port == address -> port)
+            {
+                totalSize += buffers [bufferIndex + segmentCount].dataLength;
+                ++ segmentCount;
+            }
+        }
+
+        memset (& sins [msgCount], 0, sizeof (struct sockaddr_in));
+
+        sins [msgCount].sin_family = AF_INET;
+        sins [msgCount].sin_port = ENET_HOST_TO_NET_16 (address -> port);
+        sins [msgCount].sin_addr.s_addr = address -> host;
+
+        msgHdr -> msg_name = & sins [msgCount];
+        msgHdr -> msg_namelen = sizeof (struct sockaddr_in);
+        msgHdr -> msg_iov = (struct iovec *) & buffers [bufferIndex];
+        msgHdr -> msg_iovlen = segmentCount;
+
+        if (segmentCount > 1)
+        {
+            struct cmsghdr * cmsg;
+            enet_uint16 gsoSize = (enet_uint16) segmentSize;
+
+            memset (& controls [msgCount], 0, sizeof (controls [msgCount]));
+
+            msgHdr -> msg_control = controls [msgCount].data;
+            msgHdr -> msg_controllen = sizeof (controls [msgCount].data);
+
+            cmsg = CMSG_FIRSTHDR (msgHdr);
+            cmsg -> cmsg_level = SOL_UDP;
+            cmsg -> cmsg_type = UDP_SEGMENT;
+            cmsg -> cmsg_len = CMSG_LEN (sizeof (enet_uint16));
+            memcpy (CMSG_DATA (cmsg), & gsoSize, sizeof (enet_uint16));
+        }
+
+        segmentCounts [msgCount] = segmentCount;
+        bufferIndex += segmentCount;
+        ++ msgCount;
+    }
+
+    while (msgIndex < msgCount)
+    {
+        int sentCount = sendmmsg (socket, & msgHdrs [msgIndex], msgCount - msgIndex, MSG_NOSIGNAL);
+
+        if (sentCount == -1)
+        {
+            if (errno == EWOULDBLOCK)
+              break;
+
+            if (useSegmentation && msgHdrs [msgIndex].msg_hdr.msg_controllen != 0 &&
+                (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT || errno == EOPNOTSUPP))
+            {
+                int remainingCount;
+
+                /* the system cannot segment for us, send the rest one datagram at a time from now on */
+                * segmentation = 0;
+
+                remainingCount = enet_socket_send_batch (socket, & addresses [sentBuffers], & buffers [sentBuffers], bufferCount - sentBuffers, segmentation);
+                if (remainingCount < 0)
+                  return -1;
+
+                return (int) sentBuffers + remainingCount;
+            }
+
+            return -1;
+        }
+
+        while (sentCount -- > 0)
+          sentBuffers += segmentCounts [msgIndex ++];
+    }
+
+    return (int) sentBuffers;
+#else
+    size_t bufferIndex;
+
+    if (segmentation != NULL)
+      * segmentation = 0;
+
+    for (bufferIndex = 0; bufferIndex < bufferCount; ++ bufferIndex)
+    {
+        if (enet_socket_send (socket, & addresses [bufferIndex], & buffers [bufferIndex], 1) < 0)
+          return -1;
+    }
+
+    return (int) bufferIndex;
+#endif
+}
+
 int
 enet_socketset_select (ENetSocket maxSocket, ENetSocketSet * readSet, ENetSocketSet * writeSet, enet_uint32 timeout)
 {
@@ -612,5 +910,191 @@ enet_socket_wait (ENetSocket socket, enet_uint32 * condition, enet_uint32 timeou
 #endif
 }
 
+struct _ENetSocketWaiter
+{
+#ifdef HAS_EPOLL
+    int epollSocket;
+#else
+    ENetSocket * sockets;
+    void ** socketData;
+    size_t socketCount;
+    size_t socketCapacity;
+#endif
+};
+
+ENetSocketWaiter *
+enet_socket_waiter_create (void)
+{
+    ENetSocketWaiter * waiter = (ENetSocketWaiter *) enet_malloc (sizeof (ENetSocketWaiter));
+    if (waiter == NULL)
+      return NULL;
+
+#ifdef HAS_EPOLL
+    waiter -> epollSocket = epoll_create1 (EPOLL_CLOEXEC);
+    if (waiter -> epollSocket < 0)
+    {
+        enet_free (waiter);
+
+        return NULL;
+    }
+#else
+    waiter -> sockets = NULL;
+    waiter -> socketData = NULL;
+    waiter -> socketCount = 0;
+    waiter -> socketCapacity = 0;
+#endif
+
+    return waiter;
+}
+
+void
+enet_socket_waiter_destroy (ENetSocketWaiter * waiter)
+{
+    if (waiter == NULL)
+      return;
+
+#ifdef HAS_EPOLL
+    close (waiter -> epollSocket);
+#else
+    if (waiter -> sockets != NULL)
+      enet_free (waiter -> sockets);
+#endif
+
+    enet_free (waiter);
+}
+
+int
+enet_socket_waiter_add (ENetSocketWaiter * waiter, ENetSocket socket, void * data)
+{
+#ifdef HAS_EPOLL
+    struct epoll_event epollEvent;
+
+    memset (& epollEvent, 0, sizeof (struct epoll_event));
+    epollEvent.events = EPOLLIN;
+    epollEvent.data.ptr = data;
+
+    return epoll_ctl (waiter -> epollSocket, EPOLL_CTL_ADD, socket, & epollEvent);
+#else
+    if (socket < 0 || socket >= FD_SETSIZE)
+      return -1;
+
+    if (waiter -> socketCount >= waiter -> socketCapacity)
+    {
+        size_t socketCapacity = waiter -> socketCapacity > 0 ? waiter -> socketCapacity * 2 : 16;
+        ENetSocket * sockets = (ENetSocket *) enet_malloc (socketCapacity * (sizeof (ENetSocket) + sizeof (void *)));
+        void ** socketData;
+
+        if (sockets == NULL)
+          return -1;
+
+        socketData = (void **) & sockets [socketCapacity];
+
+        if (waiter -> sockets != NULL)
+        {
+            memcpy (sockets, waiter -> sockets, waiter -> socketCount * sizeof (ENetSocket));
+            memcpy (socketData, waiter -> socketData, waiter -> socketCount * sizeof (void *));
+
+            enet_free (waiter -> sockets);
+        }
+
+        waiter -> sockets = sockets;
+        waiter -> socketData = socketData;
+        waiter -> socketCapacity = socketCapacity;
+    }
+
+    waiter -> sockets [waiter -> socketCount] = socket;
+    waiter -> socketData [waiter -> socketCount] = data;
+    ++ waiter -> socketCount;
+
+    return 0;
+#endif
+}
+
+int
+enet_socket_waiter_remove (ENetSocketWaiter * waiter, ENetSocket socket)
+{
+#ifdef HAS_EPOLL
+    struct epoll_event epollEvent;
+
+    memset (& epollEvent, 0, sizeof (struct epoll_event));
+
+    return epoll_ctl (waiter -> epollSocket, EPOLL_CTL_DEL, socket, & epollEvent);
+#else
+    size_t socketIndex;
+
+    for (socketIndex = 0; socketIndex < waiter -> socketCount; ++ socketIndex)
+    {
+        if (waiter -> sockets [socketIndex] != socket)
+          continue;
+
+        -- waiter -> socketCount;
+
+        waiter -> sockets [socketIndex] = waiter -> sockets [waiter -> socketCount];
+        waiter -> socketData [socketIndex] = waiter -> socketData [waiter -> socketCount];
+
+        return 0;
+    }
+
+    return -1;
+#endif
+}
+
+int
+enet_socket_waiter_wait (ENetSocketWaiter * waiter, void ** readyData, size_t readyLimit, enet_uint32 timeout)
+{
+#ifdef HAS_EPOLL
+    struct epoll_event epollEvents [ENET_SOCKET_WAITER_MAXIMUM_EVENTS];
+    int eventCount, eventIndex;
+
+    if (readyLimit > ENET_SOCKET_WAITER_MAXIMUM_EVENTS)
+      readyLimit = ENET_SOCKET_WAITER_MAXIMUM_EVENTS;
+
+    eventCount = epoll_wait (waiter -> epollSocket, epollEvents, (int) readyLimit, (int) timeout);
+
+    if (eventCount < 0)
+      return errno == EINTR ? 0 : -1;
+
+    for (eventIndex = 0; eventIndex < eventCount; ++ eventIndex)
+      readyData [eventIndex] = epollEvents [eventIndex].data.ptr;
+
+    return eventCount;
+#else
+    fd_set readSet;
+    struct timeval timeVal;
+    ENetSocket maxSocket = 0;
+    size_t socketIndex, readyCount = 0;
+    int selectCount;
+
+    timeVal.tv_sec = timeout / 1000;
+    timeVal.tv_usec = (timeout % 1000) * 1000;
+
+    FD_ZERO (& readSet);
+
+    for (socketIndex = 0; socketIndex < waiter -> socketCount; ++ socketIndex)
+    {
+        FD_SET (waiter -> sockets [socketIndex], & readSet);
+
+        if (waiter -> sockets [socketIndex] > maxSocket)
+          maxSocket = waiter -> sockets [socketIndex];
+    }
+
+    selectCount = select (maxSocket + 1, & readSet, NULL, NULL, & timeVal);
+
+    if (selectCount < 0)
+      return errno == EINTR ? 0 : -1;
+
+    for (socketIndex = 0; socketIndex < waiter -> socketCount && readyCount < readyLimit && selectCount > 0; ++ socketIndex)
+    {
+        if (! FD_ISSET (waiter -> sockets [socketIndex], & readSet))
+          continue;
+
+        readyData [readyCount ++] = waiter -> socketData [socketIndex];
+        -- selectCount;
+    }
+
+    return (int) readyCount;
+#endif
+}
+
 #endif
 
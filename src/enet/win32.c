@@ -30,6 +30,8 @@ enet_initialize (void)
 
     timeBeginPeriod (1);
 
+    enet_crc32_initialize ();
+
     return 0;
 }
 
@@ -53,6 +55,23 @@ enet_time_get (void)
     return (enet_uint32) timeGetTime () - timeBase;
 }
 
+enet_uint32
+enet_time_get_precise (enet_uint32 * microseconds)
+{
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    if (frequency.QuadPart == 0)
+      QueryPerformanceFrequency (& frequency);
+
+    QueryPerformanceCounter (& counter);
+
+    * microseconds = (enet_uint32) ((counter.QuadPart / frequency.QuadPart) * 1000000 +
+                                    (counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart);
+
+    return (enet_uint32) timeGetTime () - timeBase;
+}
+
 void
 enet_time_set (enet_uint32 newTimeBase)
 {
@@ -232,6 +251,10 @@ enet_socket_set_option (ENetSocket socket, ENetSocketOption option, int value)
             result = setsockopt (socket, IPPROTO_TCP, TCP_NODELAY, (char *) & value, sizeof (int));
             break;
 
+        case ENET_SOCKOPT_DONTFRAGMENT:
+            result = setsockopt (socket, IPPROTO_IP, IP_DONTFRAGMENT, (char *) & value, sizeof (int));
+            break;
+
         default:
             break;
     }
@@ -373,13 +396,15 @@ enet_socket_receive (ENetSocket socket,
        case WSAEWOULDBLOCK:
        case WSAECONNRESET:
           return 0;
+       case WSAEMSGSIZE:
+          return -2;
        }
 
        return -1;
     }
 
     if (flags & MSG_PARTIAL)
-      return -1;
+      return -2;
 
     if (address != NULL)
     {
@@ -390,6 +415,58 @@ enet_socket_receive (ENetSocket socket,
     return (int) recvLength;
 }
 
+int
+enet_socket_receive_batch (ENetSocket socket,
+                           ENetAddress * addresses,
+                           ENetBuffer * buffers,
+                           size_t * receivedLengths,
+                           size_t bufferCount)
+{
+    size_t bufferIndex;
+
+    for (bufferIndex = 0; bufferIndex < bufferCount; ++ bufferIndex)
+    {
+        int recvLength = enet_socket_receive (socket, addresses != NULL ? & addresses [bufferIndex] : NULL, & buffers [bufferIndex], 1);
+
+        if (recvLength == -2)
+        {
+            receivedLengths [bufferIndex] = 0;
+            continue;
+        }
+
+        if (recvLength < 0)
+          return bufferIndex > 0 ? (int) bufferIndex : -1;
+
+        if (recvLength == 0)
+          break;
+
+        receivedLengths [bufferIndex] = recvLength;
+    }
+
+    return (int) bufferIndex;
+}
+
+int
+enet_socket_send_batch (ENetSocket socket,
+                        const ENetAddress * addresses,
+                        const ENetBuffer * buffers,
+                        size_t bufferCount,
+                        int * segmentation)
+{
+    size_t bufferIndex;
+
+    if (segmentation != NULL)
+      * segmentation = 0;
+
+    for (bufferIndex = 0; bufferIndex < bufferCount; ++ bufferIndex)
+    {
+        if (enet_socket_send (socket, & addresses [bufferIndex], & buffers [bufferIndex], 1) < 0)
+          return -1;
+    }
+
+    return (int) bufferIndex;
+}
+
 int
 enet_socketset_select (ENetSocket maxSocket, ENetSocketSet * readSet, ENetSocketSet * writeSet, enet_uint32 timeout)
 {
@@ -439,5 +516,138 @@ enet_socket_wait (ENetSocket socket, enet_uint32 * condition, enet_uint32 timeou
     return 0;
 } 
 
+struct _ENetSocketWaiter
+{
+    ENetSocket * sockets;
+    void ** socketData;
+    size_t socketCount;
+    size_t socketCapacity;
+};
+
+ENetSocketWaiter *
+enet_socket_waiter_create (void)
+{
+    ENetSocketWaiter * waiter = (ENetSocketWaiter *) enet_malloc (sizeof (ENetSocketWaiter));
+    if (waiter == NULL)
+      return NULL;
+
+    waiter -> sockets = NULL;
+    waiter -> socketData = NULL;
+    waiter -> socketCount = 0;
+    waiter -> socketCapacity = 0;
+
+    return waiter;
+}
+
+void
+enet_socket_waiter_destroy (ENetSocketWaiter * waiter)
+{
+    if (waiter == NULL)
+      return;
+
+    if (waiter -> sockets != NULL)
+      enet_free (waiter -> sockets);
+
+    enet_free (waiter);
+}
+
+int
+enet_socket_waiter_add (ENetSocketWaiter * waiter, ENetSocket socket, void * data)
+{
+    if (socket == ENET_SOCKET_NULL || waiter -> socketCount >= FD_SETSIZE)
+      return -1;
+
+    if (waiter -> socketCount >= waiter -> socketCapacity)
+    {
+        size_t socketCapacity = waiter -> socketCapacity > 0 ? waiter -> socketCapacity * 2 : 16;
+        ENetSocket * sockets = (ENetSocket *) enet_malloc (socketCapacity * (sizeof (ENetSocket) + sizeof (void *)));
+        void ** socketData;
+
+        if (sockets == NULL)
+          return -1;
+
+        socketData = (void **) & sockets [socketCapacity];
+
+        if (waiter -> sockets != NULL)
+        {
+            memcpy (sockets, waiter -> sockets, waiter -> socketCount * sizeof (ENetSocket));
+            memcpy (socketData, waiter -> socketData, waiter -> socketCount * sizeof (void *));
+
+            enet_free (waiter -> sockets);
+        }
+
+        waiter -> sockets = sockets;
+        waiter -> socketData = socketData;
+        waiter -> socketCapacity = socketCapacity;
+    }
+
+    waiter -> sockets [waiter -> socketCount] = socket;
+    waiter -> socketData [waiter -> socketCount] = data;
+    ++ waiter -> socketCount;
+
+    return 0;
+}
+
+int
+enet_socket_waiter_remove (ENetSocketWaiter * waiter, ENetSocket socket)
+{
+    size_t socketIndex;
+
+    for (socketIndex = 0; socketIndex < waiter -> socketCount; ++ socketIndex)
+    {
+        if (waiter -> sockets [socketIndex] != socket)
+          continue;
+
+        -- waiter -> socketCount;
+
+        waiter -> sockets [socketIndex] = waiter -> sockets [waiter -> socketCount];
+        waiter -> socketData [socketIndex] = waiter -> socketData [waiter -> socketCount];
+
+        return 0;
+    }
+
+    return -1;
+}
+
+int
+enet_socket_waiter_wait (ENetSocketWaiter * waiter, void ** readyData, size_t readyLimit, enet_uint32 timeout)
+{
+    fd_set readSet;
+    struct timeval timeVal;
+    size_t socketIndex, readyCount = 0;
+    int selectCount;
+
+    if (waiter -> socketCount == 0)
+    {
+        Sleep (timeout);
+
+        return 0;
+    }
+
+    timeVal.tv_sec = timeout / 1000;
+    timeVal.tv_usec = (timeout % 1000) * 1000;
+
+    FD_ZERO (& readSet);
+
+    for (socketIndex = 0; socketIndex < waiter -> socketCount; ++ socketIndex)
+      FD_SET (waiter -> sockets [socketIndex], & readSet);
+
+    selectCount = select (0, & readSet, NULL, NULL, & timeVal);
+
+    if (selectCount < 0)
+      return -1;
+
+    for (socketIndex = 0; socketIndex < waiter -> socketCount && readyCount < readyLimit && selectCount > 0; ++ socketIndex)
+    {
+        if (! FD_ISSET (waiter -> sockets [socketIndex], & readSet))
+          continue;
+
+        readyData [readyCount ++] = waiter -> socketData [socketIndex];
+        -- selectCount;
+    }
+
+    return (int) readyCount;
+}
+
 #endif
 
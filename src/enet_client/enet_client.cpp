@@ -9,12 +9,92 @@
 
 #include "enet_client.h"
 #include "enet_client_impl.h"
+#include "enet_service_loop.h"
+#include "base.h"
 
 EnetClientSink::~EnetClientSink()
 {
 
 }
 
+void EnetClientSink::on_enet_recv(const void * data, uint32_t size, uint8_t channel)
+{
+    on_enet_recv(data, size);
+}
+
+EnetClientOptions::EnetClientOptions()
+    : channel_count(1)
+    , receive_batch_size(0)
+    , send_batch_size(0)
+    , send_segmentation(false)
+    , object_pools(true)
+    , mtu(0)
+    , mtu_probing(false)
+    , congestion_control(EnetCongestionControl::throttle)
+    , pacing(false)
+    , acknowledge_ranges(false)
+    , fec_group_sizes(nullptr)
+    , checksum(false)
+    , compression(EnetCompression::none)
+    , compression_dictionary(nullptr)
+    , compression_dictionary_size(0)
+    , service(nullptr)
+{
+
+}
+
+EnetClientService::EnetClientService()
+    : m_impl(nullptr)
+{
+
+}
+
+EnetClientService::~EnetClientService()
+{
+    exit();
+}
+
+bool EnetClientService::init(uint32_t thread_count)
+{
+    exit();
+
+    do
+    {
+        m_impl = new EnetClientServiceImpl;
+        if (nullptr == m_impl)
+        {
+            break;
+        }
+
+        if (!m_impl->init(thread_count))
+        {
+            break;
+        }
+
+        return true;
+    } while (false);
+
+    exit();
+
+    return false;
+}
+
+void EnetClientService::exit()
+{
+    if (nullptr != m_impl)
+    {
+        if (m_impl->is_loop_thread())
+        {
+            RUN_LOG_ERR("enet client service exit failure while called on a thread of the service");
+            return;
+        }
+
+        m_impl->exit();
+        delete m_impl;
+        m_impl = nullptr;
+    }
+}
+
 EnetClient::EnetClient()
     : m_impl(nullptr)
 {
@@ -27,9 +107,20 @@ EnetClient::~EnetClient()
 }
 
 bool EnetClient::init(EnetClientSink * sink, const char * host, uint16_t port)
+{
+    return init(sink, host, port, EnetClientOptions());
+}
+
+bool EnetClient::init(EnetClientSink * sink, const char * host, uint16_t port, const EnetClientOptions & options)
 {
     exit();
 
+    /* a client cannot be initialized again on the service thread of its loop */
+    if (nullptr != m_impl)
+    {
+        return false;
+    }
+
     do
     {
         m_impl = new EnetClientImpl;
@@ -38,7 +129,7 @@ bool EnetClient::init(EnetClientSink * sink, const char * host, uint16_t port)
             break;
         }
 
-        if (!m_impl->init(sink, host, port))
+        if (!m_impl->init(sink, host, port, options))
         {
             break;
         }
@@ -55,6 +146,13 @@ void EnetClient::exit()
 {
     if (nullptr != m_impl)
     {
+        /* removing the client locks its loop, which the loop thread holds while it calls the sink back */
+        if (m_impl->is_service_thread())
+        {
+            RUN_LOG_ERR("enet client exit failure while called back on the service thread of the client");
+            return;
+        }
+
         m_impl->exit();
         delete m_impl;
         m_impl = nullptr;
@@ -79,7 +177,22 @@ void EnetClient::close()
 
 bool EnetClient::send_message(const void * data, uint32_t size)
 {
-    return nullptr != m_impl && m_impl->send_message(data, size);
+    return nullptr != m_impl && m_impl->send_message(data, size, 0, EnetDelivery::reliable, nullptr, nullptr);
+}
+
+bool EnetClient::send_message(const void * data, uint32_t size, uint8_t channel, EnetDelivery delivery)
+{
+    return nullptr != m_impl && m_impl->send_message(data, size, channel, delivery, nullptr, nullptr);
+}
+
+bool EnetClient::send_message(const void * data, uint32_t size, EnetReleaseCallback release, void * context)
+{
+    return nullptr != m_impl && m_impl->send_message(data, size, 0, EnetDelivery::reliable, release, context);
+}
+
+bool EnetClient::send_message(const void * data, uint32_t size, uint8_t channel, EnetDelivery delivery, EnetReleaseCallback release, void * context)
+{
+    return nullptr != m_impl && m_impl->send_message(data, size, channel, delivery, release, context);
 }
 
 bool EnetClient::is_connected() const
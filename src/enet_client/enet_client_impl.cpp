@@ -7,27 +7,43 @@
  * Copyright(C): 2024
  ********************************************************/
 
+#include <cstring>
+#include <algorithm>
 #include "enet_client_impl.h"
 #include "base.h"
 
+extern "C"
+{
+    #include "times.h"
+}
+
+static const uint32_t s_send_queue_capacity = 1024;
+static const uint32_t s_send_buffer_size = ENET_HOST_DEFAULT_MTU;
+static const uint32_t s_connect_timeout = 5000;
+static const uint32_t s_max_service_timeout = 1000;
+static const uint32_t s_pooled_packet_data_size = 512;
+static const uint32_t s_fec_flush_timeout = 20;
+static const uint32_t s_max_discard_count = 256;
+
 EnetClientImpl::EnetClientImpl()
     : m_running(false)
     , m_sink(nullptr)
     , m_host()
     , m_port(0)
+    , m_options()
     , m_enet_host(nullptr)
     , m_enet_peer(nullptr)
-    , m_send_data_list()
-    , m_send_data_mutex()
-    , m_send_data_thread()
+    , m_connect_deadline(0)
+    , m_connected(false)
+    , m_channel_count(0)
+    , m_send_queue()
+    , m_fec_encoders()
+    , m_fec_decoders()
+    , m_service_loop(nullptr)
+    , m_private_loop(nullptr)
+    , m_scheduled(false)
     , m_event_list()
     , m_event_mutex()
-    , m_event_condition()
-    , m_event_thread()
-    , m_callback_list()
-    , m_callback_mutex()
-    , m_callback_condition()
-    , m_callback_thread()
 {
 
 }
@@ -37,13 +53,13 @@ EnetClientImpl::~EnetClientImpl()
     exit();
 }
 
-bool EnetClientImpl::init(EnetClientSink * sink, const char * host, uint16_t port)
+bool EnetClientImpl::init(EnetClientSink * sink, const char * host, uint16_t port, const EnetClientOptions & options)
 {
     exit();
 
     RUN_LOG_DBG("enet client init begin");
 
-    if (nullptr == host || 0 == port)
+    if (nullptr == host || 0 == port || 0 == options.channel_count)
     {
         RUN_LOG_ERR("enet client init failure while invalid parameters");
         return false;
@@ -55,90 +71,132 @@ bool EnetClientImpl::init(EnetClientSink * sink, const char * host, uint16_t por
         return false;
     }
 
-    ENetHost * enet_host = enet_host_create(nullptr, 1, 1, 0, 0);
-    if (nullptr == enet_host)
-    {
-        RUN_LOG_ERR("enet client init failure while create enet host failed");
-        return false;
-    }
-
     m_running = true;
     m_sink = sink;
     m_host = host;
     m_port = port;
-    m_enet_host = enet_host;
+    m_options = options;
+    m_options.compression_dictionary = nullptr; /* copied into the compressor, the caller may free it */
+    m_options.fec_group_sizes = nullptr; /* copied into the encoders, the caller may free it */
 
-    m_event_thread = std::thread([this]{
-        while (m_running)
+    do
+    {
+        m_fec_encoders.resize(options.channel_count);
+        m_fec_decoders.resize(options.channel_count);
+        if (nullptr != options.fec_group_sizes)
         {
-            std::list<bool> event_list;
-
+            uint8_t channel = 0;
+            for (channel = 0; channel < options.channel_count; ++channel)
             {
-                std::unique_lock<std::mutex> locker(m_event_mutex);
-                while (m_running && m_event_list.empty())
+                uint8_t group_size = options.fec_group_sizes[channel];
+                if (1 == group_size || group_size > EnetFecEncoder::max_group_size)
                 {
-                    m_event_condition.wait(locker);
+                    break;
                 }
-                event_list.swap(m_event_list);
+                m_fec_encoders[channel].init(group_size);
+                m_fec_decoders[channel].init(0 != group_size);
             }
-
-            for (std::list<bool>::const_iterator iter = event_list.begin(); event_list.end() != iter && m_running; ++iter)
+            if (channel < options.channel_count)
             {
-                if (*iter)
-                {
-                    do_connect();
-                }
-                else
-                {
-                    do_close();
-                }
+                RUN_LOG_ERR("enet client init failure while invalid fec group size");
+                break;
             }
         }
-    });
 
-    m_callback_thread = std::thread([this]{
-        while (m_running)
+        if (!m_send_queue.init(s_send_queue_capacity, s_send_buffer_size))
+        {
+            RUN_LOG_ERR("enet client init failure while create send queue failed");
+            break;
+        }
+
+        m_enet_host = enet_host_create(nullptr, 1, options.channel_count, 0, 0);
+        if (nullptr == m_enet_host)
+        {
+            RUN_LOG_ERR("enet client init failure while create enet host failed");
+            break;
+        }
+
+        if (enet_host_receive_batch(m_enet_host, options.receive_batch_size) < 0 || enet_host_send_batch(m_enet_host, options.send_batch_size, options.send_segmentation ? 1 : 0) < 0)
         {
-            std::list<bool> callback_list;
+            RUN_LOG_ERR("enet client init failure while enable batched receive or send failed");
+            break;
+        }
 
+        if (options.object_pools && enet_host_pool(m_enet_host, 1, s_pooled_packet_data_size) < 0)
+        {
+            RUN_LOG_ERR("enet client init failure while enable object pools failed");
+            break;
+        }
+
+        if ((0 != options.mtu || options.mtu_probing) && enet_host_mtu(m_enet_host, (0 != options.mtu ? options.mtu : ENET_HOST_DEFAULT_MTU), (options.mtu_probing ? 1 : 0)) < 0)
+        {
+            RUN_LOG_ERR("enet client init failure while set mtu failed");
+            break;
+        }
+
+        if (EnetCongestionControl::cubic == options.congestion_control)
+        {
+            enet_host_congestion_control(m_enet_host, ENET_CONGESTION_CONTROL_CUBIC);
+        }
+
+        if (options.pacing)
+        {
+            enet_host_pacing(m_enet_host, 1);
+        }
+
+        if (options.acknowledge_ranges)
+        {
+            enet_host_acknowledge_ranges(m_enet_host, 1);
+        }
+
+        if (options.checksum)
+        {
+            m_enet_host->checksum = enet_crc32;
+        }
+
+        if (EnetCompression::range_coder == options.compression && enet_host_compress_with_range_coder(m_enet_host) < 0)
+        {
+            RUN_LOG_ERR("enet client init failure while enable range coder failed");
+            break;
+        }
+
+        if (EnetCompression::lz == options.compression && enet_host_compress_with_lz_coder(m_enet_host, options.compression_dictionary, options.compression_dictionary_size) < 0)
+        {
+            RUN_LOG_ERR("enet client init failure while enable lz coder failed");
+            break;
+        }
+
+        if (nullptr != options.service)
+        {
+            if (nullptr == options.service->m_impl || nullptr == (m_service_loop = options.service->m_impl->acquire_loop()))
             {
-                std::unique_lock<std::mutex> locker(m_callback_mutex);
-                while (m_running && m_callback_list.empty())
-                {
-                    m_callback_condition.wait(locker);
-                }
-                callback_list.swap(m_callback_list);
+                RUN_LOG_ERR("enet client init failure while the service is not initialized");
+                break;
             }
-
-            for (std::list<bool>::const_iterator iter = callback_list.begin(); callback_list.end() != iter && m_running; ++iter)
+        }
+        else
+        {
+            m_private_loop = new EnetServiceLoop;
+            if (nullptr == m_private_loop || !m_private_loop->init())
             {
-                if (nullptr == m_sink)
-                {
-                    continue;
-                }
-                if (*iter)
-                {
-                    m_sink->on_enet_connect();
-                }
-                else
-                {
-                    m_sink->on_enet_close();
-                }
+                RUN_LOG_ERR("enet client init failure while create service loop failed");
+                break;
             }
+            m_service_loop = m_private_loop;
         }
-    });
 
-    do
-    {
-        if (!m_event_thread.joinable())
+        /* adding to the loop locks it, which the loop thread already holds while it calls a sink back */
+        if (m_service_loop->is_loop_thread())
         {
-            RUN_LOG_ERR("enet client init failure while create event thread failed");
+            RUN_LOG_ERR("enet client init failure while called back on the thread of its service loop");
+            m_service_loop = nullptr;
             break;
         }
 
-        if (!m_callback_thread.joinable())
+        if (!m_service_loop->add_client(this, m_enet_host->socket))
         {
-            RUN_LOG_ERR("enet client init failure while create callback thread failed");
+            RUN_LOG_ERR("enet client init failure while add to service loop failed");
+            m_service_loop = nullptr;
             break;
         }
 
@@ -162,22 +220,29 @@ void EnetClientImpl::exit()
 
         m_running = false;
 
-        do_close();
+        /* once removed the service loop no longer touches this client, the host is ours again */
+        if (nullptr != m_service_loop)
+        {
+            m_service_loop->remove_client(this);
+            m_service_loop = nullptr;
+        }
 
-        if (m_event_thread.joinable())
+        if (nullptr != m_private_loop)
         {
-            m_event_condition.notify_one();
-            m_event_thread.join();
+            m_private_loop->exit();
+            delete m_private_loop;
+            m_private_loop = nullptr;
         }
 
-        if (m_callback_thread.joinable())
+        if (nullptr != m_enet_peer)
         {
-            m_callback_condition.notify_one();
-            m_callback_thread.join();
+            enet_peer_disconnect_now(m_enet_peer, 0);
+            m_enet_peer = nullptr;
         }
 
-        m_event_list.clear();
-        m_callback_list.clear();
+        m_connected = false;
+        m_channel_count = 0;
+        m_scheduled = false;
 
         if (nullptr != m_enet_host)
         {
@@ -185,7 +250,12 @@ void EnetClientImpl::exit()
             m_enet_host = nullptr;
         }
 
-        m_enet_peer = nullptr;
+        m_event_list.clear();
+
+        m_send_queue.exit();
+
+        m_fec_encoders.clear();
+        m_fec_decoders.clear();
 
         RUN_LOG_DBG("enet client exit end");
     }
@@ -197,7 +267,7 @@ void EnetClientImpl::connect()
         std::lock_guard<std::mutex> locker(m_event_mutex);
         m_event_list.push_back(true);
     }
-    m_event_condition.notify_one();
+    schedule();
 }
 
 void EnetClientImpl::close()
@@ -206,53 +276,162 @@ void EnetClientImpl::close()
         std::lock_guard<std::mutex> locker(m_event_mutex);
         m_event_list.push_back(false);
     }
-    m_event_condition.notify_one();
+    schedule();
+}
+
+uint32_t EnetClientImpl::service()
+{
+    /* an exchange (not a store) so that the producers' queue writes are visible below */
+    m_scheduled.exchange(false);
+
+    std::list<bool> event_list;
+
+    {
+        std::lock_guard<std::mutex> locker(m_event_mutex);
+        event_list.swap(m_event_list);
+    }
+
+    for (std::list<bool>::const_iterator iter = event_list.begin(); event_list.end() != iter; ++iter)
+    {
+        if (*iter)
+        {
+            do_connect();
+        }
+        else
+        {
+            do_close();
+        }
+    }
+
+    if (nullptr == m_enet_peer)
+    {
+        discard_datagrams();
+        return EnetServiceLoop::infinite_timeout;
+    }
+
+    do_send();
+
+    uint32_t fec_timeout = flush_fec();
+
+    ENetEvent event;
+    int ret = 0;
+    while (nullptr != m_enet_peer && (ret = enet_host_service(m_enet_host, &event, 0)) > 0)
+    {
+        switch (event.type)
+        {
+            case ENET_EVENT_TYPE_CONNECT:
+            {
+                on_connect();
+                do_send();
+                break;
+            }
+            case ENET_EVENT_TYPE_RECEIVE:
+            {
+                if (nullptr != m_sink)
+                {
+                    if (event.channelID < m_fec_decoders.size() && m_fec_decoders[event.channelID].enabled())
+                    {
+                        EnetFecDecoder & decoder = m_fec_decoders[event.channelID];
+                        const uint8_t * data = nullptr;
+                        uint32_t size = 0;
+                        if (decoder.receive(event.packet->data, static_cast<uint32_t>(event.packet->dataLength), data, size))
+                        {
+                            if (nullptr != data)
+                            {
+                                m_sink->on_enet_recv(data, size, event.channelID);
+                            }
+                            if (decoder.recover(data, size))
+                            {
+                                m_sink->on_enet_recv(data, size, event.channelID);
+                            }
+                        }
+                    }
+                    else
+                    {
+                        m_sink->on_enet_recv(event.packet->data, static_cast<uint32_t>(event.packet->dataLength), event.channelID);
+                    }
+                }
+                enet_packet_destroy(event.packet);
+                break;
+            }
+            case ENET_EVENT_TYPE_DISCONNECT:
+            {
+                m_enet_peer = nullptr;
+                on_close();
+                break;
+            }
+            default:
+            {
+                break;
+            }
+        }
+    }
+
+    if (nullptr == m_enet_peer)
+    {
+        return EnetServiceLoop::infinite_timeout;
+    }
+
+    if (ret < 0)
+    {
+        RUN_LOG_ERR("enet client service failure while enet host service failed");
+        do_close();
+        return EnetServiceLoop::infinite_timeout;
+    }
+
+    uint32_t max_timeout = std::min<uint32_t>(s_max_service_timeout, fec_timeout);
+    if (!m_connected)
+    {
+        enet_uint32 now = enet_time_get();
+        if (!ENET_TIME_LESS(now, m_connect_deadline))
+        {
+            do_close();
+            return EnetServiceLoop::infinite_timeout;
+        }
+        max_timeout = std::min<uint32_t>(max_timeout, ENET_TIME_DIFFERENCE(m_connect_deadline, now));
+    }
+
+    return enet_host_service_timeout(m_enet_host, max_timeout);
 }
 
 void EnetClientImpl::on_connect()
 {
+    m_channel_count = static_cast<uint32_t>(m_enet_peer->channelCount);
+    m_connected = true;
+    if (nullptr != m_sink)
     {
-        std::lock_guard<std::mutex> locker(m_callback_mutex);
-        m_callback_list.push_back(true);
+        m_sink->on_enet_connect();
     }
-    m_callback_condition.notify_one();
 }
 
 void EnetClientImpl::on_close()
 {
+    m_connected = false;
+    m_channel_count = 0;
+    if (nullptr != m_sink)
     {
-        std::lock_guard<std::mutex> locker(m_callback_mutex);
-        m_callback_list.push_back(false);
+        m_sink->on_enet_close();
     }
-    m_callback_condition.notify_one();
 }
 
 void EnetClientImpl::do_connect()
 {
-    if (!m_running)
-    {
-        on_close();
-        return;
-    }
+    do_close();
 
-    if (nullptr != m_enet_peer && ENetPeerState::ENET_PEER_STATE_DISCONNECTED != m_enet_peer->state)
-    {
-        enet_peer_reset(m_enet_peer);
-    }
+    m_send_queue.clear();
 
-    if (m_send_data_thread.joinable())
+    /* group numbers start over with the new connection */
+    for (size_t channel = 0; channel < m_fec_encoders.size(); ++channel)
     {
-        m_send_data_thread.join();
+        m_fec_encoders[channel].reset();
+        m_fec_decoders[channel].reset();
     }
 
-    m_enet_peer = nullptr;
-    m_send_data_list.clear();
-
     ENetAddress address;
     enet_address_set_host(&address, m_host.c_str());
     address.port = m_port;
 
-    ENetPeer * enet_peer = enet_host_connect(m_enet_host, &address, 1, 0);
+    ENetPeer * enet_peer = enet_host_connect(m_enet_host, &address, m_options.channel_count, 0);
     if (nullptr == enet_peer)
     {
         if (nullptr != m_sink)
@@ -263,109 +442,210 @@ void EnetClientImpl::do_connect()
         return;
     }
 
-    ENetEvent event;
-    if (enet_host_service(m_enet_host, &event, 5000) > 0 && ENET_EVENT_TYPE_CONNECT == event.type)
+    m_enet_peer = enet_peer;
+    m_connect_deadline = enet_time_get() + s_connect_timeout;
+}
+
+void EnetClientImpl::do_close()
+{
+    if (nullptr == m_enet_peer)
     {
-        m_enet_peer = enet_peer;
-        on_connect();
+        return;
     }
-    else
+
+    enet_peer_disconnect_now(m_enet_peer, 0);
+    m_enet_peer = nullptr;
+
+    on_close();
+}
+
+void EnetClientImpl::do_send()
+{
+    if (!m_connected)
     {
-        enet_peer_reset(enet_peer);
-        on_close();
         return;
     }
 
-    m_send_data_thread = std::thread([this]{
-        ENetEvent event;
-        while (true)
+    EnetSendBuffer * buffer = nullptr;
+    while (nullptr != (buffer = m_send_queue.pop()))
+    {
+        uint8_t channel = buffer->channel;
+        if (channel < m_fec_encoders.size() && m_fec_encoders[channel].enabled())
         {
-            std::list<std::vector<uint8_t>> send_data_list;
-
-            {
-                std::lock_guard<std::mutex> locker(m_send_data_mutex);
-                send_data_list.swap(m_send_data_list);
-            }
-
-            for (std::list<std::vector<uint8_t>>::const_iterator iter = send_data_list.begin(); send_data_list.end() != iter; ++iter)
+            /* the header goes in front of the message, so it is copied once more into a packet of its own */
+            EnetFecEncoder & encoder = m_fec_encoders[channel];
+            const void * data = (nullptr != buffer->external_data) ? buffer->external_data : buffer->data;
+            uint32_t size = buffer->size;
+            enet_uint32 flags = buffer->flags;
+            bool protect = 0 == (flags & ENET_PACKET_FLAG_RELIABLE);
+            ENetPacket * packet = enet_host_packet_create(m_enet_host, nullptr, EnetFecEncoder::header_size + size, flags);
+            if (nullptr != packet)
             {
-                const std::vector<uint8_t> & data = *iter;
-
-                ENetPacket * packet = enet_packet_create(data.data(), data.size(), ENET_PACKET_FLAG_RELIABLE);
-                if (nullptr != packet && enet_peer_send(m_enet_peer, 0, packet) < 0)
+                encoder.write(packet->data, protect);
+                if (0 != size)
                 {
-                    enet_packet_destroy(packet);
+                    memcpy(packet->data + EnetFecEncoder::header_size, data, size);
                 }
             }
-
-            if (enet_host_service(m_enet_host, &event, 1) > 0)
+            m_send_queue.release(buffer);
+            if (nullptr == packet)
             {
-                switch (event.type)
-                {
-                    case ENET_EVENT_TYPE_RECEIVE:
-                    {
-                        if (nullptr != m_sink)
-                        {
-                            m_sink->on_enet_recv(event.packet->data, static_cast<uint32_t>(event.packet->dataLength));
-                        }
-                        enet_packet_destroy(event.packet);
-                        break;
-                    }
-                    case ENET_EVENT_TYPE_DISCONNECT:
-                    {
-                        on_close();
-                        return;
-                    }
-                    default:
-                    {
-                        break;
-                    }
-                }
+                continue;
+            }
+            if (enet_peer_send(m_enet_peer, channel, packet) < 0)
+            {
+                enet_packet_destroy(packet);
+                continue;
             }
-            else if (!is_connected())
+            /* only a message that went out joins the parity, the packet is still held by its outgoing command */
+            if (protect && encoder.add(packet->data + EnetFecEncoder::header_size, size, enet_time_get()))
             {
-                return;
+                send_fec_parity(channel);
             }
+            continue;
+        }
+
+        ENetPacket * packet = m_send_queue.create_packet(m_enet_host, buffer);
+        if (nullptr != packet && enet_peer_send(m_enet_peer, channel, packet) < 0)
+        {
+            enet_packet_destroy(packet);
         }
-    });
+    }
 }
 
-void EnetClientImpl::do_close()
+void EnetClientImpl::discard_datagrams()
 {
-    if (is_connected())
+    /*
+     * the socket stays in the wait set of the service loop while there is no peer,
+     * a datagram left unread there (a late resend of the server) would wake the loop at once forever
+     */
+    uint8_t data = 0;
+    ENetBuffer buffer;
+    buffer.data = &data;
+    buffer.dataLength = sizeof(data);
+    for (uint32_t count = 0; count < s_max_discard_count; ++count)
     {
-        if (nullptr != m_enet_peer)
+        /* a datagram longer than the buffer is still taken off the socket */
+        if (0 == enet_socket_receive(m_enet_host->socket, nullptr, &buffer, 1))
         {
-            enet_peer_disconnect(m_enet_peer, 0);
+            break;
         }
+    }
+}
+
+void EnetClientImpl::send_fec_parity(uint8_t channel)
+{
+    /* unsequenced, so that a parity message is never dropped for arriving behind the next group */
+    const std::vector<uint8_t> & parity = m_fec_encoders[channel].finish();
+    ENetPacket * packet = enet_host_packet_create(m_enet_host, &parity[0], parity.size(), ENET_PACKET_FLAG_UNSEQUENCED | ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT);
+    if (nullptr != packet && enet_peer_send(m_enet_peer, channel, packet) < 0)
+    {
+        enet_packet_destroy(packet);
+    }
+}
 
-        if (m_send_data_thread.joinable())
+uint32_t EnetClientImpl::flush_fec()
+{
+    /* a group is closed early rather than leave its messages unprotected while the sender is idle */
+    uint32_t timeout = EnetServiceLoop::infinite_timeout;
+    if (!m_connected)
+    {
+        return timeout;
+    }
+
+    enet_uint32 now = enet_time_get();
+    for (size_t channel = 0; channel < m_fec_encoders.size(); ++channel)
+    {
+        EnetFecEncoder & encoder = m_fec_encoders[channel];
+        if (!encoder.pending())
+        {
+            continue;
+        }
+        uint32_t elapsed = ENET_TIME_DIFFERENCE(now, encoder.open_time());
+        if (elapsed >= s_fec_flush_timeout)
         {
-            m_send_data_thread.join();
+            send_fec_parity(static_cast<uint8_t>(channel));
         }
+        else
+        {
+            timeout = std::min<uint32_t>(timeout, s_fec_flush_timeout - elapsed);
+        }
+    }
 
-        m_enet_peer = nullptr;
+    return timeout;
+}
 
-        on_close();
+void EnetClientImpl::schedule()
+{
+    /* only the first request since the client was last serviced queues it on the loop */
+    if (nullptr != m_service_loop && !m_scheduled.exchange(true))
+    {
+        m_service_loop->schedule_client(this);
     }
 }
 
-bool EnetClientImpl::send_message(const void * data, uint32_t size)
+bool EnetClientImpl::send_message(const void * data, uint32_t size, uint8_t channel, EnetDelivery delivery, EnetReleaseCallback release, void * context)
 {
-    if (!is_connected())
+    if (!is_connected() || channel >= m_channel_count)
     {
         return false;
     }
 
+    enet_uint32 flags = 0;
+    switch (delivery)
     {
-        std::lock_guard<std::mutex> locker(m_send_data_mutex);
-        m_send_data_list.emplace_back(std::vector<uint8_t>(reinterpret_cast<const uint8_t *>(data), reinterpret_cast<const uint8_t *>(data) + size));
+        case EnetDelivery::reliable:
+        {
+            flags = ENET_PACKET_FLAG_RELIABLE;
+            break;
+        }
+        case EnetDelivery::unreliable:
+        {
+            flags = 0;
+            break;
+        }
+        case EnetDelivery::unsequenced:
+        {
+            flags = ENET_PACKET_FLAG_UNSEQUENCED;
+            break;
+        }
+        case EnetDelivery::unreliable_fragment:
+        {
+            flags = ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT;
+            break;
+        }
+        default:
+        {
+            return false;
+        }
     }
 
+    if (nullptr == release)
+    {
+        if (!m_send_queue.push(data, size, channel, flags))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        if (!m_send_queue.push(data, size, channel, flags, release, context))
+        {
+            return false;
+        }
+    }
+
+    schedule();
+
     return true;
 }
 
 bool EnetClientImpl::is_connected() const
 {
-    return nullptr != m_enet_peer && ENetPeerState::ENET_PEER_STATE_CONNECTED == m_enet_peer->state;
+    return m_connected;
+}
+
+bool EnetClientImpl::is_service_thread() const
+{
+    return nullptr != m_service_loop && m_service_loop->is_loop_thread();
 }
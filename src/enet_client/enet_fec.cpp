@@ -0,0 +1,300 @@
+/********************************************************
+ * Description : enet client forward error correction
+ * Author      : yanrk
+ * Email       : yanrkchina@163.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * Copyright(C): 2024
+ ********************************************************/
+
+#include "enet_fec.h"
+
+enum EnetFecKind
+{
+    enet_fec_kind_plain = 0,
+    enet_fec_kind_data = 1,
+    enet_fec_kind_parity = 2
+};
+
+static const uint32_t s_length_size = 4;
+
+const uint32_t EnetFecEncoder::header_size;
+const uint32_t EnetFecEncoder::max_group_size;
+
+static void write_header(uint8_t * header, uint16_t group, uint8_t index, uint8_t kind)
+{
+    header[0] = static_cast<uint8_t>(group >> 8);
+    header[1] = static_cast<uint8_t>(group);
+    header[2] = index;
+    header[3] = kind;
+}
+
+/* xors a message, prefixed by its length, into sum from offset on, sum grows with zeros to fit */
+static void xor_message(std::vector<uint8_t> & sum, uint32_t offset, const uint8_t * data, uint32_t size)
+{
+    if (sum.size() < offset + s_length_size + size)
+    {
+        sum.resize(offset + s_length_size + size, 0);
+    }
+
+    uint8_t * dst = &sum[offset];
+    dst[0] ^= static_cast<uint8_t>(size >> 24);
+    dst[1] ^= static_cast<uint8_t>(size >> 16);
+    dst[2] ^= static_cast<uint8_t>(size >> 8);
+    dst[3] ^= static_cast<uint8_t>(size);
+
+    dst += s_length_size;
+    for (uint32_t index = 0; index < size; ++index)
+    {
+        dst[index] ^= data[index];
+    }
+}
+
+EnetFecEncoder::EnetFecEncoder()
+    : m_group_size(0)
+    , m_group(0)
+    , m_count(0)
+    , m_open_time(0)
+    , m_parity()
+{
+
+}
+
+void EnetFecEncoder::init(uint32_t group_size)
+{
+    m_group_size = group_size;
+    reset();
+}
+
+void EnetFecEncoder::reset()
+{
+    m_group = 0;
+    m_count = 0;
+    m_open_time = 0;
+    m_parity.clear();
+}
+
+bool EnetFecEncoder::enabled() const
+{
+    return 0 != m_group_size;
+}
+
+bool EnetFecEncoder::pending() const
+{
+    return 0 != m_count;
+}
+
+uint32_t EnetFecEncoder::open_time() const
+{
+    return m_open_time;
+}
+
+void EnetFecEncoder::write(uint8_t * header, bool protect) const
+{
+    if (!protect)
+    {
+        write_header(header, m_group, 0, enet_fec_kind_plain);
+        return;
+    }
+
+    write_header(header, m_group, static_cast<uint8_t>(m_count), enet_fec_kind_data);
+}
+
+bool EnetFecEncoder::add(const void * data, uint32_t size, uint32_t now)
+{
+    /* a message that failed to go out never joins the group, so its index is given to the next one */
+    if (0 == m_count)
+    {
+        /* the header of the parity message is written in front of the sum by finish */
+        m_parity.assign(header_size, 0);
+        m_open_time = now;
+    }
+
+    /* the sum lives behind the header of the parity message */
+    xor_message(m_parity, header_size, reinterpret_cast<const uint8_t *>(data), size);
+
+    return ++m_count >= m_group_size;
+}
+
+const std::vector<uint8_t> & EnetFecEncoder::finish()
+{
+    write_header(&m_parity[0], m_group, static_cast<uint8_t>(m_count), enet_fec_kind_parity);
+    ++m_group;
+    m_count = 0;
+    return m_parity;
+}
+
+EnetFecDecoder::EnetFecDecoder()
+    : m_enabled(false)
+    , m_groups()
+    , m_recovered()
+    , m_has_recovered(false)
+{
+    init(false);
+}
+
+void EnetFecDecoder::init(bool enabled)
+{
+    m_enabled = enabled;
+    reset();
+}
+
+void EnetFecDecoder::reset()
+{
+    for (uint32_t index = 0; index < s_group_window; ++index)
+    {
+        m_groups[index].used = false;
+    }
+    m_has_recovered = false;
+}
+
+bool EnetFecDecoder::enabled() const
+{
+    return m_enabled;
+}
+
+bool EnetFecDecoder::receive(const uint8_t * data, uint32_t size, const uint8_t *& payload, uint32_t & payload_size)
+{
+    m_has_recovered = false;
+    payload = nullptr;
+    payload_size = 0;
+
+    if (size < EnetFecEncoder::header_size)
+    {
+        return false;
+    }
+
+    uint16_t id = static_cast<uint16_t>((data[0] << 8) | data[1]);
+    uint32_t index = data[2];
+    uint32_t kind = data[3];
+    const uint8_t * body = data + EnetFecEncoder::header_size;
+    uint32_t body_size = size - EnetFecEncoder::header_size;
+
+    switch (kind)
+    {
+        case enet_fec_kind_plain:
+        {
+            payload = body;
+            payload_size = body_size;
+            return true;
+        }
+        case enet_fec_kind_data:
+        {
+            if (index >= EnetFecEncoder::max_group_size)
+            {
+                return false;
+            }
+            Group * current = group(id);
+            if (nullptr == current || 0 != (current->received & (1u << index)))
+            {
+                /* a group that has left the window, or a message already delivered itself or rebuilt from the parity */
+                return true;
+            }
+            payload = body;
+            payload_size = body_size;
+            current->received |= 1u << index;
+            if (current->done)
+            {
+                return true;
+            }
+            xor_message(current->sum, 0, body, body_size);
+            rebuild(*current);
+            return true;
+        }
+        case enet_fec_kind_parity:
+        {
+            if (0 == index || index > EnetFecEncoder::max_group_size || body_size < s_length_size)
+            {
+                return false;
+            }
+            Group * current = group(id);
+            if (nullptr == current || current->done || current->parity)
+            {
+                return true;
+            }
+            if (current->sum.size() < body_size)
+            {
+                current->sum.resize(body_size, 0);
+            }
+            for (uint32_t offset = 0; offset < body_size; ++offset)
+            {
+                current->sum[offset] ^= body[offset];
+            }
+            current->parity = true;
+            current->count = index;
+            rebuild(*current);
+            return true;
+        }
+        default:
+        {
+            return false;
+        }
+    }
+}
+
+bool EnetFecDecoder::recover(const uint8_t *& data, uint32_t & size) const
+{
+    if (!m_has_recovered)
+    {
+        return false;
+    }
+    data = m_recovered.empty() ? nullptr : &m_recovered[0];
+    size = static_cast<uint32_t>(m_recovered.size());
+    return true;
+}
+
+EnetFecDecoder::Group * EnetFecDecoder::group(uint16_t id)
+{
+    Group & slot = m_groups[id % s_group_window];
+    if (slot.used && slot.id != id && static_cast<int16_t>(id - slot.id) < 0)
+    {
+        /* the group has left the window, whether its messages were delivered is no longer known */
+        return nullptr;
+    }
+    if (!slot.used || slot.id != id)
+    {
+        /* a newer group takes over the slot */
+        slot.used = true;
+        slot.done = false;
+        slot.parity = false;
+        slot.id = id;
+        slot.count = 0;
+        slot.received = 0;
+        slot.sum.clear();
+    }
+    return &slot;
+}
+
+void EnetFecDecoder::rebuild(Group & group)
+{
+    if (!group.parity)
+    {
+        return;
+    }
+
+    uint32_t mask = (group.count >= 32) ? 0xFFFFFFFFu : ((1u << group.count) - 1);
+    uint32_t missing = mask & ~group.received;
+    if (0 == missing)
+    {
+        group.done = true;
+        return;
+    }
+    if (0 != (missing & (missing - 1)))
+    {
+        return;
+    }
+
+    /* what is left of the sum is the length prefixed lost message */
+    group.done = true;
+    const uint8_t * sum = &group.sum[0];
+    uint32_t size = (static_cast<uint32_t>(sum[0]) << 24) | (static_cast<uint32_t>(sum[1]) << 16) | (static_cast<uint32_t>(sum[2]) << 8) | sum[3];
+    if (size > group.sum.size() - s_length_size)
+    {
+        return;
+    }
+    m_recovered.assign(sum + s_length_size, sum + s_length_size + size);
+    m_has_recovered = true;
+
+    /* a late copy of the lost message is not delivered again */
+    group.received |= missing;
+}
@@ -0,0 +1,410 @@
+/********************************************************
+ * Description : enet client send queue
+ * Author      : yanrk
+ * Email       : yanrkchina@163.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * Copyright(C): 2024
+ ********************************************************/
+
+#include <cstdlib>
+#include <cstring>
+#include "enet_send_queue.h"
+
+static const uint32_t s_max_retained_buffer_size = 64 * 1024;
+
+EnetBoundedQueue::EnetBoundedQueue()
+    : m_cells(nullptr)
+    , m_mask(0)
+    , m_enqueue_padding()
+    , m_enqueue_pos(0)
+    , m_dequeue_padding()
+    , m_dequeue_pos(0)
+{
+
+}
+
+EnetBoundedQueue::~EnetBoundedQueue()
+{
+    exit();
+}
+
+bool EnetBoundedQueue::init(uint32_t capacity)
+{
+    exit();
+
+    size_t cell_count = 2;
+    while (cell_count < capacity)
+    {
+        cell_count <<= 1;
+    }
+
+    m_cells = new Cell[cell_count];
+    if (nullptr == m_cells)
+    {
+        return false;
+    }
+
+    for (size_t index = 0; index < cell_count; ++index)
+    {
+        m_cells[index].sequence.store(index, std::memory_order_relaxed);
+        m_cells[index].buffer = nullptr;
+    }
+
+    m_mask = cell_count - 1;
+    m_enqueue_pos.store(0, std::memory_order_relaxed);
+    m_dequeue_pos.store(0, std::memory_order_relaxed);
+
+    return true;
+}
+
+void EnetBoundedQueue::exit()
+{
+    if (nullptr != m_cells)
+    {
+        delete [] m_cells;
+        m_cells = nullptr;
+    }
+    m_mask = 0;
+}
+
+bool EnetBoundedQueue::push(EnetSendBuffer * buffer)
+{
+    Cell * cell = nullptr;
+    size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+    while (true)
+    {
+        cell = &m_cells[pos & m_mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if (0 == diff)
+        {
+            if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->buffer = buffer;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+
+    return true;
+}
+
+bool EnetBoundedQueue::pop(EnetSendBuffer *& buffer)
+{
+    Cell * cell = nullptr;
+    size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+    while (true)
+    {
+        cell = &m_cells[pos & m_mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+        if (0 == diff)
+        {
+            if (m_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = m_dequeue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    buffer = cell->buffer;
+    cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+
+    return true;
+}
+
+EnetSendQueue::EnetSendQueue()
+    : m_buffers(nullptr)
+    , m_buffer_count(0)
+    , m_buffer_size(0)
+    , m_free_queue()
+    , m_send_queue()
+{
+
+}
+
+EnetSendQueue::~EnetSendQueue()
+{
+    exit();
+}
+
+bool EnetSendQueue::init(uint32_t capacity, uint32_t buffer_size)
+{
+    exit();
+
+    if (0 == capacity)
+    {
+        return false;
+    }
+
+    do
+    {
+        if (!m_free_queue.init(capacity) || !m_send_queue.init(capacity))
+        {
+            break;
+        }
+
+        m_buffers = new EnetSendBuffer[capacity];
+        if (nullptr == m_buffers)
+        {
+            break;
+        }
+
+        m_buffer_count = capacity;
+        m_buffer_size = buffer_size;
+
+        for (uint32_t index = 0; index < m_buffer_count; ++index)
+        {
+            EnetSendBuffer & buffer = m_buffers[index];
+            buffer.queue = this;
+            buffer.data = nullptr;
+            buffer.size = 0;
+            buffer.capacity = 0;
+            buffer.pooled = true;
+            buffer.channel = 0;
+            buffer.flags = 0;
+            buffer.external_data = nullptr;
+            buffer.release = nullptr;
+            buffer.context = nullptr;
+            m_free_queue.push(&buffer);
+        }
+
+        return true;
+    } while (false);
+
+    exit();
+
+    return false;
+}
+
+void EnetSendQueue::exit()
+{
+    clear();
+
+    if (nullptr != m_buffers)
+    {
+        for (uint32_t index = 0; index < m_buffer_count; ++index)
+        {
+            free(m_buffers[index].data);
+        }
+        delete [] m_buffers;
+        m_buffers = nullptr;
+    }
+
+    m_buffer_count = 0;
+    m_buffer_size = 0;
+
+    m_free_queue.exit();
+    m_send_queue.exit();
+}
+
+bool EnetSendQueue::push(const void * data, uint32_t size, uint8_t channel, enet_uint32 flags)
+{
+    if (nullptr == m_buffers || (nullptr == data && 0 != size))
+    {
+        return false;
+    }
+
+    EnetSendBuffer * buffer = acquire();
+    if (nullptr == buffer)
+    {
+        return false;
+    }
+
+    if (!reserve(buffer, size))
+    {
+        release(buffer);
+        return false;
+    }
+
+    if (0 != size)
+    {
+        memcpy(buffer->data, data, size);
+    }
+    buffer->size = size;
+    buffer->channel = channel;
+    buffer->flags = flags;
+
+    if (!m_send_queue.push(buffer))
+    {
+        release(buffer);
+        return false;
+    }
+
+    return true;
+}
+
+bool EnetSendQueue::push(const void * data, uint32_t size, uint8_t channel, enet_uint32 flags, EnetReleaseCallback release_callback, void * context)
+{
+    if (nullptr == m_buffers || nullptr == release_callback || (nullptr == data && 0 != size))
+    {
+        return false;
+    }
+
+    EnetSendBuffer * buffer = acquire();
+    if (nullptr == buffer)
+    {
+        return false;
+    }
+
+    buffer->size = size;
+    buffer->channel = channel;
+    buffer->flags = flags;
+    buffer->external_data = data;
+    buffer->release = release_callback;
+    buffer->context = context;
+
+    if (!m_send_queue.push(buffer))
+    {
+        /* the caller keeps the ownership of a message which was not queued */
+        buffer->release = nullptr;
+        release(buffer);
+        return false;
+    }
+
+    return true;
+}
+
+EnetSendBuffer * EnetSendQueue::pop()
+{
+    EnetSendBuffer * buffer = nullptr;
+    if (nullptr == m_buffers || !m_send_queue.pop(buffer))
+    {
+        return nullptr;
+    }
+    return buffer;
+}
+
+ENetPacket * EnetSendQueue::create_packet(ENetHost * host, EnetSendBuffer * buffer)
+{
+    const void * data = (nullptr != buffer->external_data) ? buffer->external_data : buffer->data;
+    ENetPacket * packet = enet_host_packet_create(host, data, buffer->size, buffer->flags | ENET_PACKET_FLAG_NO_ALLOCATE);
+    if (nullptr == packet)
+    {
+        release(buffer);
+        return nullptr;
+    }
+
+    packet->userData = buffer;
+    packet->freeCallback = &EnetSendQueue::free_packet;
+
+    return packet;
+}
+
+void EnetSendQueue::release(EnetSendBuffer * buffer)
+{
+    if (nullptr == buffer)
+    {
+        return;
+    }
+
+    if (nullptr != buffer->release)
+    {
+        buffer->release(buffer->external_data, buffer->size, buffer->context);
+    }
+    buffer->external_data = nullptr;
+    buffer->release = nullptr;
+    buffer->context = nullptr;
+
+    if (!buffer->pooled)
+    {
+        free(buffer->data);
+        delete buffer;
+        return;
+    }
+
+    if (buffer->capacity > s_max_retained_buffer_size)
+    {
+        free(buffer->data);
+        buffer->data = nullptr;
+        buffer->capacity = 0;
+    }
+
+    buffer->size = 0;
+    m_free_queue.push(buffer);
+}
+
+void EnetSendQueue::clear()
+{
+    if (nullptr == m_buffers)
+    {
+        return;
+    }
+
+    EnetSendBuffer * buffer = nullptr;
+    while (m_send_queue.pop(buffer))
+    {
+        release(buffer);
+    }
+}
+
+EnetSendBuffer * EnetSendQueue::acquire()
+{
+    EnetSendBuffer * buffer = nullptr;
+    if (!m_free_queue.pop(buffer))
+    {
+        /* every pooled buffer is queued or still owned by enet, fall back to the heap */
+        buffer = new EnetSendBuffer;
+        if (nullptr == buffer)
+        {
+            return nullptr;
+        }
+        buffer->queue = this;
+        buffer->data = nullptr;
+        buffer->size = 0;
+        buffer->capacity = 0;
+        buffer->pooled = false;
+        buffer->channel = 0;
+        buffer->flags = 0;
+        buffer->external_data = nullptr;
+        buffer->release = nullptr;
+        buffer->context = nullptr;
+    }
+    return buffer;
+}
+
+bool EnetSendQueue::reserve(EnetSendBuffer * buffer, uint32_t size)
+{
+    if (buffer->capacity < size || nullptr == buffer->data)
+    {
+        uint32_t capacity = (buffer->pooled && size < m_buffer_size) ? m_buffer_size : size;
+        uint8_t * data = reinterpret_cast<uint8_t *>(malloc(0 != capacity ? capacity : 1));
+        if (nullptr == data)
+        {
+            return false;
+        }
+        free(buffer->data);
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    return true;
+}
+
+void EnetSendQueue::free_packet(ENetPacket * packet)
+{
+    EnetSendBuffer * buffer = reinterpret_cast<EnetSendBuffer *>(packet->userData);
+    if (nullptr != buffer)
+    {
+        packet->userData = nullptr;
+        buffer->queue->release(buffer);
+    }
+}
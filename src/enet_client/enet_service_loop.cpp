@@ -0,0 +1,451 @@
+/********************************************************
+ * Description : enet client service loop
+ * Author      : yanrk
+ * Email       : yanrkchina@163.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * Copyright(C): 2024
+ ********************************************************/
+
+#include <chrono>
+#include <cerrno>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif // __linux__
+#include "enet_service_loop.h"
+#include "enet_client_impl.h"
+#include "base.h"
+
+static const uint32_t s_max_wait_timeout = 1000;
+static const size_t s_max_ready_count = 64;
+
+static uint64_t service_loop_time()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+const uint32_t EnetServiceLoop::infinite_timeout;
+
+thread_local const EnetServiceLoop * EnetServiceLoop::s_thread_loop = nullptr;
+
+EnetServiceLoop::EnetServiceLoop()
+    : m_running(false)
+    , m_waiter(nullptr)
+    , m_thread()
+    , m_wakeup_read_fd(-1)
+    , m_wakeup_write_fd(-1)
+    , m_wakeup_pending(false)
+    , m_clients()
+    , m_deadlines()
+    , m_client_count(0)
+    , m_client_mutex()
+    , m_schedule_list()
+    , m_schedule_mutex()
+{
+
+}
+
+EnetServiceLoop::~EnetServiceLoop()
+{
+    exit();
+}
+
+bool EnetServiceLoop::init()
+{
+    exit();
+
+    if (enet_initialize() < 0)
+    {
+        RUN_LOG_ERR("enet service loop init failure while enet initialize failed");
+        return false;
+    }
+
+    m_waiter = enet_socket_waiter_create();
+    if (nullptr == m_waiter)
+    {
+        RUN_LOG_ERR("enet service loop init failure while create socket waiter failed");
+        return false;
+    }
+
+    do
+    {
+        if (!create_wakeup())
+        {
+            RUN_LOG_ERR("enet service loop init failure while create wakeup failed");
+            break;
+        }
+
+        if (enet_socket_waiter_add(m_waiter, m_wakeup_read_fd, this) < 0)
+        {
+            RUN_LOG_ERR("enet service loop init failure while wait on wakeup failed");
+            break;
+        }
+
+        m_running = true;
+
+        m_thread = std::thread([this]{
+            run();
+        });
+
+        if (!m_thread.joinable())
+        {
+            RUN_LOG_ERR("enet service loop init failure while create service thread failed");
+            break;
+        }
+
+        return true;
+    } while (false);
+
+    exit();
+
+    return false;
+}
+
+void EnetServiceLoop::exit()
+{
+    m_running = false;
+
+    if (m_thread.joinable())
+    {
+        notify_wakeup();
+        m_thread.join();
+    }
+
+    m_clients.clear();
+    m_deadlines.clear();
+    m_client_count = 0;
+    m_schedule_list.clear();
+
+    if (nullptr != m_waiter)
+    {
+        enet_socket_waiter_destroy(m_waiter);
+        m_waiter = nullptr;
+    }
+
+    destroy_wakeup();
+}
+
+bool EnetServiceLoop::add_client(EnetClientImpl * client, ENetSocket socket)
+{
+    std::lock_guard<std::mutex> locker(m_client_mutex);
+
+    if (nullptr == m_waiter || m_clients.end() != m_clients.find(client))
+    {
+        return false;
+    }
+
+    if (enet_socket_waiter_add(m_waiter, socket, client) < 0)
+    {
+        RUN_LOG_ERR("enet service loop add client failure while wait on socket failed (%d)", errno);
+        return false;
+    }
+
+    ClientEntry & entry = m_clients[client];
+    entry.socket = socket;
+    entry.deadline = 0;
+    m_client_count = m_clients.size();
+
+    return true;
+}
+
+void EnetServiceLoop::remove_client(EnetClientImpl * client)
+{
+    {
+        std::lock_guard<std::mutex> locker(m_client_mutex);
+
+        std::unordered_map<EnetClientImpl *, ClientEntry>::iterator iter = m_clients.find(client);
+        if (m_clients.end() == iter)
+        {
+            return;
+        }
+
+        enet_socket_waiter_remove(m_waiter, iter->second.socket);
+        if (0 != iter->second.deadline)
+        {
+            m_deadlines.erase(std::make_pair(iter->second.deadline, client));
+        }
+        m_clients.erase(iter);
+        m_client_count = m_clients.size();
+    }
+
+    {
+        std::lock_guard<std::mutex> locker(m_schedule_mutex);
+        m_schedule_list.erase(std::remove(m_schedule_list.begin(), m_schedule_list.end(), client), m_schedule_list.end());
+    }
+}
+
+void EnetServiceLoop::schedule_client(EnetClientImpl * client)
+{
+    {
+        std::lock_guard<std::mutex> locker(m_schedule_mutex);
+        m_schedule_list.push_back(client);
+    }
+    notify_wakeup();
+}
+
+size_t EnetServiceLoop::client_count() const
+{
+    return m_client_count;
+}
+
+bool EnetServiceLoop::is_loop_thread() const
+{
+    return this == s_thread_loop;
+}
+
+void EnetServiceLoop::run()
+{
+    void * ready_list[s_max_ready_count];
+    std::vector<EnetClientImpl *> schedule_list;
+    std::vector<EnetClientImpl *> due_list;
+
+    s_thread_loop = this;
+
+    while (m_running)
+    {
+        int ready_count = enet_socket_waiter_wait(m_waiter, ready_list, s_max_ready_count, next_timeout());
+        if (ready_count < 0)
+        {
+            RUN_LOG_ERR("enet service loop wait failure (%d)", errno);
+            break;
+        }
+
+        /* drain the wakeup before taking the schedule list, a later schedule wakes the next wait */
+        for (int index = 0; index < ready_count; ++index)
+        {
+            if (this == ready_list[index])
+            {
+                clear_wakeup();
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> locker(m_schedule_mutex);
+            schedule_list.swap(m_schedule_list);
+        }
+
+        std::lock_guard<std::mutex> locker(m_client_mutex);
+
+        for (int index = 0; index < ready_count; ++index)
+        {
+            if (this != ready_list[index])
+            {
+                service_client(reinterpret_cast<EnetClientImpl *>(ready_list[index]));
+            }
+        }
+
+        for (std::vector<EnetClientImpl *>::const_iterator iter = schedule_list.begin(); schedule_list.end() != iter; ++iter)
+        {
+            service_client(*iter);
+        }
+        schedule_list.clear();
+
+        uint64_t now = service_loop_time();
+        while (!m_deadlines.empty() && m_deadlines.begin()->first <= now)
+        {
+            due_list.push_back(m_deadlines.begin()->second);
+            m_deadlines.erase(m_deadlines.begin());
+            m_clients[due_list.back()].deadline = 0;
+        }
+
+        for (std::vector<EnetClientImpl *>::const_iterator iter = due_list.begin(); due_list.end() != iter; ++iter)
+        {
+            service_client(*iter);
+        }
+        due_list.clear();
+    }
+}
+
+void EnetServiceLoop::service_client(EnetClientImpl * client)
+{
+    std::unordered_map<EnetClientImpl *, ClientEntry>::iterator iter = m_clients.find(client);
+    if (m_clients.end() == iter)
+    {
+        return;
+    }
+
+    uint32_t timeout = client->service();
+
+    ClientEntry & entry = iter->second;
+    if (0 != entry.deadline)
+    {
+        m_deadlines.erase(std::make_pair(entry.deadline, client));
+    }
+    entry.deadline = (infinite_timeout == timeout) ? 0 : service_loop_time() + timeout;
+    if (0 != entry.deadline)
+    {
+        m_deadlines.insert(std::make_pair(entry.deadline, client));
+    }
+}
+
+uint32_t EnetServiceLoop::next_timeout()
+{
+    std::lock_guard<std::mutex> locker(m_client_mutex);
+
+    if (m_deadlines.empty())
+    {
+        return s_max_wait_timeout;
+    }
+
+    uint64_t now = service_loop_time();
+    uint64_t deadline = m_deadlines.begin()->first;
+    if (deadline <= now)
+    {
+        return 0;
+    }
+
+    return static_cast<uint32_t>(std::min<uint64_t>(deadline - now, s_max_wait_timeout));
+}
+
+bool EnetServiceLoop::create_wakeup()
+{
+#ifdef __linux__
+    m_wakeup_read_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeup_read_fd < 0)
+    {
+        return false;
+    }
+    m_wakeup_write_fd = m_wakeup_read_fd;
+#else
+    int fds[2] = { -1, -1 };
+    if (pipe(fds) < 0)
+    {
+        return false;
+    }
+    for (int index = 0; index < 2; ++index)
+    {
+        fcntl(fds[index], F_SETFL, O_NONBLOCK | fcntl(fds[index], F_GETFL));
+        fcntl(fds[index], F_SETFD, FD_CLOEXEC);
+    }
+    m_wakeup_read_fd = fds[0];
+    m_wakeup_write_fd = fds[1];
+#endif // __linux__
+    m_wakeup_pending = false;
+    return true;
+}
+
+void EnetServiceLoop::destroy_wakeup()
+{
+    if (m_wakeup_write_fd >= 0 && m_wakeup_write_fd != m_wakeup_read_fd)
+    {
+        ::close(m_wakeup_write_fd);
+    }
+    if (m_wakeup_read_fd >= 0)
+    {
+        ::close(m_wakeup_read_fd);
+    }
+    m_wakeup_read_fd = -1;
+    m_wakeup_write_fd = -1;
+    m_wakeup_pending = false;
+}
+
+void EnetServiceLoop::notify_wakeup()
+{
+    /* only the first notify since the service thread last woke up pays for the system call */
+    if (m_wakeup_write_fd < 0 || m_wakeup_pending.exchange(true))
+    {
+        return;
+    }
+#ifdef __linux__
+    uint64_t value = 1;
+#else
+    uint8_t value = 1;
+#endif // __linux__
+    ssize_t ret = ::write(m_wakeup_write_fd, &value, sizeof(value));
+    (void)ret;
+}
+
+void EnetServiceLoop::clear_wakeup()
+{
+    m_wakeup_pending = false;
+#ifdef __linux__
+    uint64_t value = 0;
+    ssize_t ret = ::read(m_wakeup_read_fd, &value, sizeof(value));
+    (void)ret;
+#else
+    uint8_t buffer[64];
+    while (::read(m_wakeup_read_fd, buffer, sizeof(buffer)) > 0)
+    {
+
+    }
+#endif // __linux__
+}
+
+EnetClientServiceImpl::EnetClientServiceImpl()
+    : m_loops()
+{
+
+}
+
+EnetClientServiceImpl::~EnetClientServiceImpl()
+{
+    exit();
+}
+
+bool EnetClientServiceImpl::init(uint32_t thread_count)
+{
+    exit();
+
+    RUN_LOG_DBG("enet client service init begin");
+
+    if (0 == thread_count)
+    {
+        RUN_LOG_ERR("enet client service init failure while invalid parameters");
+        return false;
+    }
+
+    for (uint32_t index = 0; index < thread_count; ++index)
+    {
+        EnetServiceLoop * loop = new EnetServiceLoop;
+        if (nullptr == loop || !loop->init())
+        {
+            RUN_LOG_ERR("enet client service init failure while create service loop failed");
+            delete loop;
+            exit();
+            return false;
+        }
+        m_loops.push_back(loop);
+    }
+
+    RUN_LOG_DBG("enet client service init success");
+
+    return true;
+}
+
+void EnetClientServiceImpl::exit()
+{
+    for (std::vector<EnetServiceLoop *>::iterator iter = m_loops.begin(); m_loops.end() != iter; ++iter)
+    {
+        (*iter)->exit();
+        delete *iter;
+    }
+    m_loops.clear();
+}
+
+EnetServiceLoop * EnetClientServiceImpl::acquire_loop()
+{
+    EnetServiceLoop * service_loop = nullptr;
+    for (std::vector<EnetServiceLoop *>::iterator iter = m_loops.begin(); m_loops.end() != iter; ++iter)
+    {
+        if (nullptr == service_loop || (*iter)->client_count() < service_loop->client_count())
+        {
+            service_loop = *iter;
+        }
+    }
+    return service_loop;
+}
+
+bool EnetClientServiceImpl::is_loop_thread() const
+{
+    for (std::vector<EnetServiceLoop *>::const_iterator iter = m_loops.begin(); m_loops.end() != iter; ++iter)
+    {
+        if ((*iter)->is_loop_thread())
+        {
+            return true;
+        }
+    }
+    return false;
+}
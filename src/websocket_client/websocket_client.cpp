@@ -18,6 +18,70 @@ WebsocketClientSink::~WebsocketClientSink()
 
 }
 
+WebsocketClientOptions::WebsocketClientOptions()
+    : service(nullptr)
+{
+
+}
+
+WebsocketClientService::WebsocketClientService()
+    : m_impl(nullptr)
+{
+
+}
+
+WebsocketClientService::~WebsocketClientService()
+{
+    exit();
+}
+
+bool WebsocketClientService::init(uint32_t thread_count)
+{
+    exit();
+
+    /* a service cannot be initialized again on one of its io threads */
+    if (nullptr != m_impl)
+    {
+        return false;
+    }
+
+    do
+    {
+        m_impl = new WebsocketClientServiceImpl;
+        if (nullptr == m_impl)
+        {
+            break;
+        }
+
+        if (!m_impl->init(thread_count))
+        {
+            break;
+        }
+
+        return true;
+    } while (false);
+
+    exit();
+
+    return false;
+}
+
+void WebsocketClientService::exit()
+{
+    if (nullptr != m_impl)
+    {
+        if (m_impl->is_io_thread())
+        {
+            RUN_LOG_ERR("websocket client service exit failure while called on an io thread of the service");
+            return;
+        }
+
+        m_impl->exit();
+        delete m_impl;
+        m_impl = nullptr;
+    }
+}
+
 WebsocketClient::WebsocketClient()
     : m_session(nullptr)
 {
@@ -30,19 +94,35 @@ WebsocketClient::~WebsocketClient()
 }
 
 bool WebsocketClient::init(WebsocketClientSink * sink, const char * host, uint16_t port, bool secure)
+{
+    return init(sink, host, port, secure, WebsocketClientOptions());
+}
+
+bool WebsocketClient::init(WebsocketClientSink * sink, const char * url)
+{
+    return init(sink, url, WebsocketClientOptions());
+}
+
+bool WebsocketClient::init(WebsocketClientSink * sink, const char * host, uint16_t port, bool secure, const WebsocketClientOptions & options)
 {
     std::string url;
     if (nullptr != host && 0x0 != *host && 0 != port)
     {
         url = std::string(secure ? "wss://" : "ws://") + host + ":" + std::to_string(port);
     }
-    return init(sink, url.c_str());
+    return init(sink, url.c_str(), options);
 }
 
-bool WebsocketClient::init(WebsocketClientSink * sink, const char * url)
+bool WebsocketClient::init(WebsocketClientSink * sink, const char * url, const WebsocketClientOptions & options)
 {
     exit();
 
+    /* a client cannot be initialized again on one of its callback threads */
+    if (nullptr != m_session)
+    {
+        return false;
+    }
+
     RUN_LOG_DBG("websocket client init begin");
 
     if (nullptr == url || 0x0 == *url)
@@ -66,7 +146,19 @@ bool WebsocketClient::init(WebsocketClientSink * sink, const char * url)
         return false;
     }
 
-    if (m_session->init(sink, url))
+    asio::io_service * io_service = nullptr;
+    if (nullptr != options.service)
+    {
+        if (nullptr == options.service->m_impl)
+        {
+            RUN_LOG_ERR("websocket client init failure while the service is not initialized");
+            exit();
+            return false;
+        }
+        io_service = &options.service->m_impl->io_service();
+    }
+
+    if (m_session->init(sink, url, io_service))
     {
         RUN_LOG_DBG("websocket client init success");
         return true;
@@ -83,6 +175,13 @@ void WebsocketClient::exit()
 {
     if (nullptr != m_session)
     {
+        /* exit waits for the threads that call the sink back, on one of them it would wait for itself */
+        if (m_session->is_callback_thread())
+        {
+            RUN_LOG_ERR("websocket client exit failure while called back on a thread of the client");
+            return;
+        }
+
         RUN_LOG_DBG("websocket client exit begin");
 
         m_session->exit();
@@ -114,6 +213,11 @@ bool WebsocketClient::send_message(const void * data, uint32_t size, bool binary
     return nullptr != m_session && m_session->send_message(data, size, binary);
 }
 
+bool WebsocketClient::send_message(std::string && data, bool binary)
+{
+    return nullptr != m_session && m_session->send_message(std::move(data), binary);
+}
+
 bool WebsocketClient::is_connected() const
 {
     return nullptr != m_session && m_session->is_connected();
@@ -9,6 +9,8 @@
 
 #include "websocket_client_impl.h"
 
+thread_local const WebsocketSessionBase * WebsocketSessionBase::s_thread_session = nullptr;
+
 WebsocketSessionBase::WebsocketSessionBase()
 {
 
@@ -19,29 +21,193 @@ WebsocketSessionBase::~WebsocketSessionBase()
 
 }
 
+WebsocketClientServiceImpl::WebsocketClientServiceImpl()
+    : m_io_service()
+    , m_io_work()
+    , m_io_threads()
+{
+
+}
+
+WebsocketClientServiceImpl::~WebsocketClientServiceImpl()
+{
+    exit();
+}
+
+bool WebsocketClientServiceImpl::init(uint32_t thread_count)
+{
+    exit();
+
+    RUN_LOG_DBG("websocket client service init begin");
+
+    if (0 == thread_count)
+    {
+        RUN_LOG_ERR("websocket client service init failure while invalid parameters");
+        return false;
+    }
+
+    m_io_service.restart();
+    m_io_work.reset(new asio::io_service::work(m_io_service));
+
+    for (uint32_t index = 0; index < thread_count; ++index)
+    {
+        m_io_threads.emplace_back([this]{
+            m_io_service.run();
+        });
+        if (!m_io_threads.back().joinable())
+        {
+            RUN_LOG_ERR("websocket client service init failure while create io thread failed");
+            exit();
+            return false;
+        }
+    }
+
+    RUN_LOG_DBG("websocket client service init success");
+
+    return true;
+}
+
+void WebsocketClientServiceImpl::exit()
+{
+    if (m_io_work)
+    {
+        m_io_work.reset();
+        m_io_service.stop();
+    }
+
+    for (std::vector<std::thread>::iterator iter = m_io_threads.begin(); m_io_threads.end() != iter; ++iter)
+    {
+        if (iter->joinable())
+        {
+            iter->join();
+        }
+    }
+    m_io_threads.clear();
+}
+
+asio::io_service & WebsocketClientServiceImpl::io_service()
+{
+    return m_io_service;
+}
+
+bool WebsocketClientServiceImpl::is_io_thread()
+{
+    return m_io_service.get_executor().running_in_this_thread();
+}
+
 void WebsocketSessionPlain::set_specific_handler()
 {
-    get_client().set_socket_init_handler([this](websocketpp::connection_hdl handle, asio::ip::tcp::socket & socket){
-        set_handle(handle);
-    });
+
 }
 
-void WebsocketSessionSecure::set_specific_handler()
+/* the ssl of a connection refers to the cache of its client, which may be gone by the time a session ticket arrives */
+static void free_tls_session_cache_reference(void * parent, void * ptr, CRYPTO_EX_DATA * ad, int index, long argl, void * argp)
 {
-    get_client().set_socket_init_handler([this](websocketpp::connection_hdl handle, asio::ssl::stream<asio::ip::tcp::socket> & socket){
-        set_handle(handle);
-    });
+    delete reinterpret_cast<std::weak_ptr<WebsocketTlsSessionCache> *>(ptr);
+}
 
-    get_client().set_tls_init_handler([this](websocketpp::connection_hdl handle){
+static int tls_session_cache_index()
+{
+    static const int s_index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, &free_tls_session_cache_reference);
+    return s_index;
+}
+
+static int on_tls_new_session(SSL * ssl, SSL_SESSION * session)
+{
+    std::weak_ptr<WebsocketTlsSessionCache> * reference = reinterpret_cast<std::weak_ptr<WebsocketTlsSessionCache> *>(SSL_get_ex_data(ssl, tls_session_cache_index()));
+    std::shared_ptr<WebsocketTlsSessionCache> cache = (nullptr != reference) ? reference->lock() : nullptr;
+    if (!cache)
+    {
+        return 0;
+    }
+    cache->store(session);
+    return 1;
+}
+
+/*
+ * the one tls configuration of the clients, built once for the process
+ * instead of for every connection, an ssl context is safe to share
+ */
+static std::shared_ptr<asio::ssl::context> shared_tls_context()
+{
+    static const std::shared_ptr<asio::ssl::context> s_context = []{
         std::shared_ptr<asio::ssl::context> ctx = std::make_shared<asio::ssl::context>(asio::ssl::context::sslv23);
-        try
+        asio::error_code err;
+        ctx->set_options(asio::ssl::context::default_workarounds | asio::ssl::context::no_sslv2 | asio::ssl::context::no_sslv3 | asio::ssl::context::single_dh_use, err);
+        if (err)
         {
-            ctx->set_options(asio::ssl::context::default_workarounds | asio::ssl::context::no_sslv2 | asio::ssl::context::no_sslv3 | asio::ssl::context::single_dh_use);
+            RUN_LOG_ERR("websocket client tls context set options failure (%s)", err.message().c_str());
         }
-        catch (std::exception & e)
+        SSL_CTX_set_session_cache_mode(ctx->native_handle(), SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(ctx->native_handle(), &on_tls_new_session);
+        return ctx;
+    }();
+    return s_context;
+}
+
+WebsocketTlsSessionCache::WebsocketTlsSessionCache()
+    : m_session(nullptr)
+    , m_mutex()
+{
+
+}
+
+WebsocketTlsSessionCache::~WebsocketTlsSessionCache()
+{
+    if (nullptr != m_session)
+    {
+        SSL_SESSION_free(m_session);
+        m_session = nullptr;
+    }
+}
+
+void WebsocketTlsSessionCache::store(SSL_SESSION * session)
+{
+    SSL_SESSION * old_session = nullptr;
+
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        old_session = m_session;
+        m_session = session;
+    }
+
+    if (nullptr != old_session)
+    {
+        SSL_SESSION_free(old_session);
+    }
+}
+
+void WebsocketTlsSessionCache::offer(SSL * ssl) const
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    if (nullptr != m_session)
+    {
+        SSL_set_session(ssl, m_session);
+    }
+}
+
+WebsocketSessionSecure::WebsocketSessionSecure()
+    : m_tls_session_cache(std::make_shared<WebsocketTlsSessionCache>())
+{
+
+}
+
+void WebsocketSessionSecure::set_specific_handler()
+{
+    std::shared_ptr<WebsocketTlsSessionCache> cache = m_tls_session_cache;
+
+    get_client().set_socket_init_handler([cache](websocketpp::connection_hdl handle, asio::ssl::stream<asio::ip::tcp::socket> & socket){
+        SSL * ssl = socket.native_handle();
+        std::weak_ptr<WebsocketTlsSessionCache> * reference = new std::weak_ptr<WebsocketTlsSessionCache>(cache);
+        if (SSL_set_ex_data(ssl, tls_session_cache_index(), reference) <= 0)
         {
-            on_error("tls init", e.what());
+            delete reference;
+            return;
         }
-        return ctx;
+        cache->offer(ssl);
+    });
+
+    get_client().set_tls_init_handler([](websocketpp::connection_hdl handle){
+        return shared_tls_context();
     });
 }
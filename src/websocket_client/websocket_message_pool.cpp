@@ -0,0 +1,62 @@
+/********************************************************
+ * Description : websocket client message pool
+ * Author      : yanrk
+ * Email       : yanrkchina@163.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * Copyright(C): 2024
+ ********************************************************/
+
+#include <new>
+#include "websocket_message_pool.h"
+
+WebsocketBlockCache::WebsocketBlockCache()
+    : m_block_size(0)
+    , m_blocks()
+    , m_mutex()
+{
+
+}
+
+WebsocketBlockCache::~WebsocketBlockCache()
+{
+    for (std::vector<void *>::iterator iter = m_blocks.begin(); m_blocks.end() != iter; ++iter)
+    {
+        ::operator delete(*iter);
+    }
+    m_blocks.clear();
+}
+
+void * WebsocketBlockCache::allocate(size_t size)
+{
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        if (0 == m_block_size)
+        {
+            /* the first size asked for is the size of the control block, every later request is the same */
+            m_block_size = size;
+        }
+        if (size == m_block_size && !m_blocks.empty())
+        {
+            void * block = m_blocks.back();
+            m_blocks.pop_back();
+            return block;
+        }
+    }
+
+    return ::operator new(size);
+}
+
+void WebsocketBlockCache::deallocate(void * block, size_t size)
+{
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        if (size == m_block_size && m_blocks.size() < s_max_block_count)
+        {
+            m_blocks.push_back(block);
+            return;
+        }
+    }
+
+    ::operator delete(block);
+}
@@ -0,0 +1,256 @@
+/********************************************************
+ * Description : benchmark of enet acknowledgement cost
+ * Author      : yanrk
+ * Email       : yanrkchina@163.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * Copyright(C): 2024
+ ********************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+#include <utility>
+
+extern "C"
+{
+    #include "enet.h"
+}
+
+/*
+ * a client host sends a burst of one byte reliable packets to a server host
+ * on loopback, and the cost of matching an acknowledgement to its command
+ * is measured against the number of commands in flight:
+ *   lookup: enet_peer_find_reliable_command() on every command in flight
+ *   scan:   the walk through sentReliableCommands that acknowledgements took before
+ *   ack:    enet_host_service() of the client while the acknowledgements come in
+ * a burst goes out whole, as commands left queued would be sent while the
+ * acknowledgements come in: the sequence numbers are first padded to the
+ * second one of a reliable window, from where a channel lets out two
+ * windows less one command; the scan outlasts the round trip timeout, so
+ * the acknowledgements are timed on a burst of their own first
+ */
+
+static const int s_lookup_rounds = 20;
+
+static double elapsed_ns(std::chrono::steady_clock::time_point begin)
+{
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count());
+}
+
+static void service_host(ENetHost * host)
+{
+    ENetEvent event;
+    while (enet_host_service(host, &event, 0) > 0)
+    {
+        if (ENET_EVENT_TYPE_RECEIVE == event.type)
+        {
+            enet_packet_destroy(event.packet);
+        }
+    }
+}
+
+static bool connect_hosts(ENetHost * server, ENetHost * client, ENetPeer *& peer)
+{
+    ENetAddress address;
+    if (enet_socket_get_address(server->socket, &address) < 0)
+    {
+        return false;
+    }
+    enet_address_set_host(&address, "127.0.0.1");
+
+    peer = enet_host_connect(client, &address, 1, 0);
+    if (nullptr == peer)
+    {
+        return false;
+    }
+
+    for (int count = 0; count < 500 && ENET_PEER_STATE_CONNECTED != peer->state; ++count)
+    {
+        ENetEvent event;
+        enet_host_service(client, &event, 1);
+        service_host(server);
+    }
+
+    return ENET_PEER_STATE_CONNECTED == peer->state;
+}
+
+static void drain(ENetHost * server, ENetHost * client, ENetPeer * peer)
+{
+    for (int round = 0; round < 100 && !(enet_list_empty(&peer->sentReliableCommands) && enet_list_empty(&peer->outgoingCommands)); ++round)
+    {
+        ENetEvent event;
+        enet_host_service(client, &event, 1);
+        service_host(server);
+    }
+}
+
+static bool queue_packets(ENetPeer * peer, size_t count)
+{
+    uint8_t data = 0;
+    for (size_t index = 0; index < count; ++index)
+    {
+        ENetPacket * packet = enet_packet_create(&data, sizeof(data), ENET_PACKET_FLAG_RELIABLE);
+        if (nullptr == packet || enet_peer_send(peer, 0, packet) < 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static size_t send_burst(ENetHost * server, ENetHost * client, ENetPeer * peer, size_t count)
+{
+    size_t padding = (ENET_PEER_RELIABLE_WINDOW_SIZE - peer->channels[0].outgoingReliableSequenceNumber % ENET_PEER_RELIABLE_WINDOW_SIZE) % ENET_PEER_RELIABLE_WINDOW_SIZE;
+    if (!queue_packets(peer, padding))
+    {
+        return 0;
+    }
+    drain(server, client, peer);
+
+    if (!queue_packets(peer, count))
+    {
+        return 0;
+    }
+
+    /* a loopback round trip makes the retransmit timeout a few ms, less than a large burst takes to
+       be serviced on both sides, so a nominal one keeps resends out of the acknowledgement cost,
+       and a full throttle lets every burst out to the same window */
+    peer->roundTripTime = 100;
+    peer->roundTripTimeVariance = 0;
+    peer->packetThrottle = ENET_PEER_PACKET_THROTTLE_SCALE;
+
+    /* the window lets the burst out over several flushes */
+    size_t in_flight = 0;
+    for (int round = 0; round < 64; ++round)
+    {
+        enet_host_flush(client);
+        size_t sent = enet_list_size(&peer->sentReliableCommands);
+        if (sent == in_flight)
+        {
+            break;
+        }
+        in_flight = sent;
+    }
+    return in_flight;
+}
+
+static void measure(ENetHost * server, ENetHost * client, ENetPeer * peer, size_t count)
+{
+    size_t in_flight = send_burst(server, client, peer, count);
+    if (0 == in_flight)
+    {
+        printf("%10u  burst failed\n", static_cast<unsigned>(count));
+        return;
+    }
+
+    /* the server acknowledges the whole burst, then the client takes the acknowledgements in */
+    service_host(server);
+    enet_host_flush(server);
+
+    double client_ns = 0;
+    std::chrono::steady_clock::time_point begin;
+    for (int round = 0; round < 1000 && !enet_list_empty(&peer->sentReliableCommands); ++round)
+    {
+        begin = std::chrono::steady_clock::now();
+        ENetEvent event;
+        while (enet_host_service(client, &event, 0) > 0)
+        {
+
+        }
+        client_ns += elapsed_ns(begin);
+
+        if (!enet_list_empty(&peer->sentReliableCommands))
+        {
+            service_host(server);
+            enet_host_flush(server);
+        }
+    }
+    double ack_ns = client_ns / in_flight;
+
+    drain(server, client, peer);
+
+    size_t sent = send_burst(server, client, peer, count);
+    if (0 == sent)
+    {
+        printf("%10u  burst failed\n", static_cast<unsigned>(count));
+        return;
+    }
+
+    std::vector<std::pair<enet_uint16, enet_uint8> > keys;
+    for (ENetListIterator iter = enet_list_begin(&peer->sentReliableCommands); enet_list_end(&peer->sentReliableCommands) != iter; iter = enet_list_next(iter))
+    {
+        ENetOutgoingCommand * command = reinterpret_cast<ENetOutgoingCommand *>(iter);
+        keys.push_back(std::make_pair(command->reliableSequenceNumber, command->command.header.channelID));
+    }
+
+    size_t found = 0;
+    begin = std::chrono::steady_clock::now();
+    for (int round = 0; round < s_lookup_rounds; ++round)
+    {
+        for (size_t index = 0; index < keys.size(); ++index)
+        {
+            found += (nullptr != enet_peer_find_reliable_command(peer, keys[index].first, keys[index].second)) ? 1 : 0;
+        }
+    }
+    double lookup_ns = elapsed_ns(begin) / (s_lookup_rounds * keys.size());
+
+    begin = std::chrono::steady_clock::now();
+    for (size_t index = 0; index < keys.size(); ++index)
+    {
+        for (ENetListIterator iter = enet_list_begin(&peer->sentReliableCommands); enet_list_end(&peer->sentReliableCommands) != iter; iter = enet_list_next(iter))
+        {
+            ENetOutgoingCommand * command = reinterpret_cast<ENetOutgoingCommand *>(iter);
+            if (command->reliableSequenceNumber == keys[index].first && command->command.header.channelID == keys[index].second)
+            {
+                ++found;
+                break;
+            }
+        }
+    }
+    double scan_ns = elapsed_ns(begin) / keys.size();
+
+    printf("%10u  %12.1f  %12.1f  %12.1f%s\n", static_cast<unsigned>(in_flight), lookup_ns, scan_ns, ack_ns, (found == keys.size() * (s_lookup_rounds + 1)) ? "" : "  (lookup mismatch)");
+
+    /* let anything left over drain before the next burst */
+    drain(server, client, peer);
+}
+
+int main(int argc, char * argv[])
+{
+    if (0 != enet_initialize())
+    {
+        printf("enet initialize failed\n");
+        return 1;
+    }
+
+    ENetAddress address;
+    address.host = ENET_HOST_ANY;
+    address.port = 0;
+
+    ENetHost * server = enet_host_create(&address, 1, 1, 0, 0);
+    ENetHost * client = enet_host_create(nullptr, 1, 1, 0, 0);
+    ENetPeer * peer = nullptr;
+    if (nullptr == server || nullptr == client || !connect_hosts(server, client, peer))
+    {
+        printf("connect failed\n");
+        return 1;
+    }
+
+    printf("ns per acknowledgement\n");
+    printf("%10s  %12s  %12s  %12s\n", "in flight", "lookup", "scan", "ack");
+
+    const size_t counts[] = { 16, 64, 256, 1024, 4096, 2 * ENET_PEER_RELIABLE_WINDOW_SIZE - 1 };
+    for (size_t index = 0; index < sizeof(counts) / sizeof(counts[0]); ++index)
+    {
+        measure(server, client, peer, counts[index]);
+    }
+
+    enet_peer_disconnect_now(peer, 0);
+    enet_host_destroy(client);
+    enet_host_destroy(server);
+    enet_deinitialize();
+
+    return 0;
+}
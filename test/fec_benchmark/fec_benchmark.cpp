@@ -0,0 +1,212 @@
+/********************************************************
+ * Description : benchmark of enet client forward error correction
+ * Author      : yanrk
+ * Email       : yanrkchina@163.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * Copyright(C): 2024
+ ********************************************************/
+
+#include <cstdio>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <queue>
+#include <utility>
+#include <functional>
+#include "enet_fec.h"
+
+/*
+ * streams messages of 64 to 1200 bytes through an EnetFecEncoder and an
+ * EnetFecDecoder over a simulated channel that drops datagrams at random
+ * and delays a few of them behind later ones, as an unsequenced channel
+ * may, then reports the messages delivered with and without the parity,
+ * the bytes the parity costs, and any message delivered twice or wrong
+ */
+
+static const uint32_t s_message_count = 50000;
+static const uint32_t s_min_message_size = 64;
+static const uint32_t s_max_message_size = 1200;
+static const double s_delay_rate = 0.01;
+
+struct Datagram
+{
+    uint64_t                                                arrival;
+    uint64_t                                                order;
+    std::vector<uint8_t>                                    data;
+
+    bool operator > (const Datagram & other) const
+    {
+        return (arrival != other.arrival) ? (arrival > other.arrival) : (order > other.order);
+    }
+};
+
+struct Result
+{
+    uint32_t                                                arrived;
+    uint32_t                                                delivered;
+    uint32_t                                                recovered;
+    uint32_t                                                duplicates;
+    uint32_t                                                corrupt;
+    uint64_t                                                data_bytes;
+    uint64_t                                                parity_bytes;
+};
+
+static void fill_message(std::vector<uint8_t> & message, uint32_t number, uint32_t size)
+{
+    message.resize(size);
+    for (uint32_t index = 0; index < size; ++index)
+    {
+        message[index] = static_cast<uint8_t>(number * 31 + index);
+    }
+    message[0] = static_cast<uint8_t>(number);
+    message[1] = static_cast<uint8_t>(number >> 8);
+    message[2] = static_cast<uint8_t>(number >> 16);
+    message[3] = static_cast<uint8_t>(number >> 24);
+}
+
+static void check_message(const uint8_t * data, uint32_t size, std::vector<bool> & delivered, Result & result)
+{
+    if (size < 4)
+    {
+        ++result.corrupt;
+        return;
+    }
+
+    uint32_t number = data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+    if (number >= s_message_count)
+    {
+        ++result.corrupt;
+        return;
+    }
+
+    for (uint32_t index = 4; index < size; ++index)
+    {
+        if (static_cast<uint8_t>(number * 31 + index) != data[index])
+        {
+            ++result.corrupt;
+            return;
+        }
+    }
+
+    if (delivered[number])
+    {
+        ++result.duplicates;
+        return;
+    }
+    delivered[number] = true;
+    ++result.delivered;
+}
+
+static Result simulate(uint32_t group_size, double loss_rate, uint32_t seed)
+{
+    Result result = { 0, 0, 0, 0, 0, 0, 0 };
+
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    std::uniform_int_distribution<uint32_t> message_size(s_min_message_size, s_max_message_size);
+    std::uniform_int_distribution<uint32_t> delay(1, 2 * group_size + 1);
+
+    EnetFecEncoder encoder;
+    encoder.init(group_size);
+    EnetFecDecoder decoder;
+    decoder.init(true);
+
+    std::priority_queue<Datagram, std::vector<Datagram>, std::greater<Datagram> > channel;
+    std::vector<bool> delivered(s_message_count, false);
+    std::vector<uint8_t> message;
+    uint64_t order = 0;
+
+    std::function<void(const uint8_t *, size_t, bool)> transmit = [&](const uint8_t * data, size_t size, bool parity) {
+        (parity ? result.parity_bytes : result.data_bytes) += size;
+        if (chance(random) < loss_rate)
+        {
+            return;
+        }
+        if (!parity)
+        {
+            ++result.arrived;
+        }
+        Datagram datagram;
+        datagram.arrival = order + ((chance(random) < s_delay_rate) ? delay(random) : 0);
+        datagram.order = order;
+        datagram.data.assign(data, data + size);
+        channel.push(datagram);
+    };
+
+    std::function<void(uint64_t)> receive = [&](uint64_t now) {
+        while (!channel.empty() && channel.top().arrival <= now)
+        {
+            const std::vector<uint8_t> & data = channel.top().data;
+            const uint8_t * payload = nullptr;
+            uint32_t payload_size = 0;
+            if (decoder.receive(&data[0], static_cast<uint32_t>(data.size()), payload, payload_size))
+            {
+                if (nullptr != payload)
+                {
+                    check_message(payload, payload_size, delivered, result);
+                }
+                if (decoder.recover(payload, payload_size))
+                {
+                    ++result.recovered;
+                    check_message(payload, payload_size, delivered, result);
+                }
+            }
+            else
+            {
+                ++result.corrupt;
+            }
+            channel.pop();
+        }
+    };
+
+    std::vector<uint8_t> packet;
+    for (uint32_t number = 0; number < s_message_count; ++number)
+    {
+        fill_message(message, number, message_size(random));
+        packet.resize(EnetFecEncoder::header_size + message.size());
+        encoder.write(&packet[0], 0 != group_size);
+        std::copy(message.begin(), message.end(), packet.begin() + EnetFecEncoder::header_size);
+        transmit(&packet[0], packet.size(), false);
+        if (0 != group_size && encoder.add(&message[0], static_cast<uint32_t>(message.size()), 0))
+        {
+            const std::vector<uint8_t> & parity = encoder.finish();
+            transmit(&parity[0], parity.size(), true);
+        }
+        receive(order++);
+    }
+
+    if (0 != group_size && encoder.pending())
+    {
+        const std::vector<uint8_t> & parity = encoder.finish();
+        transmit(&parity[0], parity.size(), true);
+    }
+    receive(static_cast<uint64_t>(-1));
+
+    return result;
+}
+
+int main(int argc, char * argv[])
+{
+    const double loss_rates[] = { 0.01, 0.02, 0.05, 0.10, 0.20 };
+    const uint32_t group_sizes[] = { 0, 2, 4, 8, 16, 32 };
+
+    printf("%u messages of %u to %u bytes, %.0f%% of datagrams delayed behind later ones\n", s_message_count, s_min_message_size, s_max_message_size, s_delay_rate * 100);
+    printf("%6s  %6s  %9s  %9s  %9s  %9s  %10s  %8s\n", "loss", "group", "overhead", "arrived", "delivered", "recovered", "duplicates", "corrupt");
+
+    for (size_t loss = 0; loss < sizeof(loss_rates) / sizeof(loss_rates[0]); ++loss)
+    {
+        for (size_t group = 0; group < sizeof(group_sizes) / sizeof(group_sizes[0]); ++group)
+        {
+            Result result = simulate(group_sizes[group], loss_rates[loss], 1234);
+            printf("%5.0f%%  %6u  %8.1f%%  %8.2f%%  %8.2f%%  %9u  %10u  %8u\n",
+                loss_rates[loss] * 100, group_sizes[group],
+                100.0 * result.parity_bytes / result.data_bytes,
+                100.0 * result.arrived / s_message_count,
+                100.0 * result.delivered / s_message_count,
+                result.recovered, result.duplicates, result.corrupt);
+        }
+    }
+
+    return 0;
+}
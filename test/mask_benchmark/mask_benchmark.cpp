@@ -0,0 +1,152 @@
+/********************************************************
+ * Description : benchmark of websocket frame masking
+ * Author      : yanrk
+ * Email       : yanrkchina@163.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * Copyright(C): 2024
+ ********************************************************/
+
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#define _WEBSOCKETPP_CPP11_STL_
+#define _WEBSOCKETPP_CPP11_SYSTEM_ERROR_
+
+#include "websocketpp/frame.hpp"
+
+/*
+ * checks every masking routine of websocketpp::frame against byte_mask on
+ * all lengths up to 600 bytes at misaligned offsets, copied, in place and
+ * streamed in odd chunks, then reports the GB/s of masking a misaligned
+ * buffer with:
+ *   byte:   byte_mask
+ *   word:   the word by word loop word_mask_exact ran before vector_mask
+ *   vector: word_mask_exact, which runs vector_mask first
+ */
+
+using namespace websocketpp::frame;
+
+static const size_t s_bytes_per_run = 256 * 1024 * 1024;
+
+static void old_word_mask_exact(uint8_t * input, uint8_t * output, size_t length, const masking_key_type & key)
+{
+    size_t prepared_key = prepare_masking_key(key);
+    size_t n = length / sizeof(size_t);
+    size_t * input_word = reinterpret_cast<size_t *>(input);
+    size_t * output_word = reinterpret_cast<size_t *>(output);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        output_word[i] = input_word[i] ^ prepared_key;
+    }
+
+    for (size_t i = n * sizeof(size_t); i < length; i++)
+    {
+        output[i] = input[i] ^ key.c[i % 4];
+    }
+}
+
+static uint32_t check()
+{
+    std::mt19937 random(1);
+    uint32_t mismatches = 0;
+
+    for (size_t length = 0; length < 600; ++length)
+    {
+        for (size_t offset = 0; offset < 9; ++offset)
+        {
+            masking_key_type key;
+            key.i = random();
+
+            std::vector<uint8_t> input(length + offset + 16);
+            std::vector<uint8_t> expected(length + 16);
+            std::vector<uint8_t> output(length + offset + 16);
+            for (size_t index = 0; index < input.size(); ++index)
+            {
+                input[index] = static_cast<uint8_t>(random());
+            }
+            byte_mask(input.begin() + offset, input.begin() + offset + length, expected.begin(), key, 0);
+
+            word_mask_exact(&input[offset], &output[offset], length, key);
+            mismatches += (0 != memcmp(&output[offset], &expected[0], length)) ? 1 : 0;
+
+            std::vector<uint8_t> in_place(input);
+            word_mask_exact(&in_place[offset], length, key);
+            mismatches += (0 != memcmp(&in_place[offset], &expected[0], length)) ? 1 : 0;
+
+            for (int word = 0; word < 2; ++word)
+            {
+                std::vector<uint8_t> stream(input.begin() + offset, input.end());
+                size_t prepared_key = prepare_masking_key(key);
+                size_t position = 0;
+                while (position < length)
+                {
+                    size_t chunk = std::min<size_t>(1 + random() % 70, length - position);
+                    prepared_key = word ? word_mask_circ(&stream[position], chunk, prepared_key) : byte_mask_circ(&stream[position], chunk, prepared_key);
+                    position += chunk;
+                }
+                mismatches += (0 != memcmp(&stream[0], &expected[0], length)) ? 1 : 0;
+            }
+        }
+    }
+
+    return mismatches;
+}
+
+template <typename mask_type>
+static double gigabytes_per_second(size_t size, mask_type mask)
+{
+    std::vector<uint8_t> input(size + 1, 0x5a);
+    std::vector<uint8_t> output(size + 1);
+    masking_key_type key;
+    key.i = 0x12345678;
+
+    size_t rounds = std::max<size_t>(1, s_bytes_per_run / size);
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < rounds; ++round)
+    {
+        mask(&input[1], &output[1], size, key);
+    }
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double> >(std::chrono::steady_clock::now() - begin).count();
+    return static_cast<double>(rounds) * size / seconds / 1e9;
+}
+
+int main(int argc, char * argv[])
+{
+    uint32_t mismatches = check();
+    printf("mismatches against byte_mask: %u\n", mismatches);
+
+#if defined(_WEBSOCKETPP_AVX2_MASKING_)
+    printf("vector kernel: %s\n", has_avx2() ? "avx2" : "sse2");
+#elif defined(_WEBSOCKETPP_SSE2_MASKING_)
+    printf("vector kernel: sse2\n");
+#elif defined(_WEBSOCKETPP_NEON_MASKING_)
+    printf("vector kernel: neon\n");
+#else
+    printf("vector kernel: none\n");
+#endif
+
+    printf("GB/s\n");
+    printf("%10s  %8s  %8s  %8s\n", "size", "byte", "word", "vector");
+
+    const size_t sizes[] = { 16, 32, 64, 128, 256, 1024, 16384, 1024 * 1024 };
+    for (size_t index = 0; index < sizeof(sizes) / sizeof(sizes[0]); ++index)
+    {
+        double byte = gigabytes_per_second(sizes[index], [](uint8_t * input, uint8_t * output, size_t length, const masking_key_type & key) {
+            byte_mask(input, input + length, output, key, 0);
+        });
+        double word = gigabytes_per_second(sizes[index], old_word_mask_exact);
+        double vector = gigabytes_per_second(sizes[index], [](uint8_t * input, uint8_t * output, size_t length, const masking_key_type & key) {
+            word_mask_exact(input, output, length, key);
+        });
+        printf("%10u  %8.2f  %8.2f  %8.2f\n", static_cast<unsigned>(sizes[index]), byte, word, vector);
+    }
+
+    return 0 == mismatches ? 0 : 1;
+}
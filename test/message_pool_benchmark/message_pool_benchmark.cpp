@@ -0,0 +1,137 @@
+/********************************************************
+ * Description : benchmark of websocket client message pool
+ * Author      : yanrk
+ * Email       : yanrkchina@163.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * Copyright(C): 2024
+ ********************************************************/
+
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include "websocket_client_impl.h"
+
+/*
+ * takes messages of a frame size from a WebsocketMessagePool and from the
+ * stock websocketpp manager in bursts, fills them and releases the burst,
+ * and reports:
+ *   the heap allocations per message, a burst beyond what a pool holds
+ *   per size class goes partly to the heap
+ *   the messages per second of threads that each use a pool of their own,
+ *   as the connections of a client do
+ */
+
+static std::atomic<uint64_t> s_allocations(0);
+
+void * operator new (size_t size)
+{
+    ++s_allocations;
+    void * block = malloc(0 == size ? 1 : size);
+    if (nullptr == block)
+    {
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+void operator delete (void * block) noexcept
+{
+    free(block);
+}
+
+void operator delete (void * block, size_t) noexcept
+{
+    free(block);
+}
+
+typedef WebsocketClientConfig::message_type pooled_message_type;
+typedef WebsocketClientConfig::con_msg_manager_type pooled_manager_type;
+typedef websocketpp::config::asio_client::message_type stock_message_type;
+typedef websocketpp::config::asio_client::con_msg_manager_type stock_manager_type;
+
+static const uint32_t s_message_count = 50000;
+
+template <typename manager_type>
+static void run(manager_type & manager, size_t size, size_t burst, uint32_t count)
+{
+    std::vector<typename manager_type::message_ptr> messages;
+    messages.reserve(burst);
+    for (uint32_t index = 0; index < count; ++index)
+    {
+        typename manager_type::message_ptr message = manager.get_message(websocketpp::frame::opcode::BINARY, size);
+        message->get_raw_payload().assign(size, static_cast<char>(index));
+        messages.push_back(message);
+        if (messages.size() == burst)
+        {
+            messages.clear();
+        }
+    }
+}
+
+template <typename manager_type>
+static double allocations_per_message(size_t size, size_t burst)
+{
+    std::shared_ptr<manager_type> manager = std::make_shared<manager_type>();
+    run(*manager, size, burst, 1024);
+    uint64_t before = s_allocations;
+    run(*manager, size, burst, s_message_count);
+    return static_cast<double>(s_allocations - before) / s_message_count;
+}
+
+template <typename manager_type>
+static double messages_per_second(size_t size, uint32_t thread_count)
+{
+    std::vector<std::thread> threads;
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    for (uint32_t index = 0; index < thread_count; ++index)
+    {
+        threads.emplace_back([size]{
+            std::shared_ptr<manager_type> manager = std::make_shared<manager_type>();
+            run(*manager, size, 1, s_message_count);
+        });
+    }
+    for (std::vector<std::thread>::iterator iter = threads.begin(); threads.end() != iter; ++iter)
+    {
+        iter->join();
+    }
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double> >(std::chrono::steady_clock::now() - begin).count();
+    return thread_count * s_message_count / seconds;
+}
+
+int main(int argc, char * argv[])
+{
+    const size_t sizes[] = { 100, 1000, 16000, 200000 };
+    const size_t bursts[] = { 1, 16, 64 };
+
+    printf("heap allocations per message\n");
+    printf("%8s  %6s  %8s  %8s\n", "size", "burst", "stock", "pooled");
+    for (size_t size = 0; size < sizeof(sizes) / sizeof(sizes[0]); ++size)
+    {
+        for (size_t burst = 0; burst < sizeof(bursts) / sizeof(bursts[0]); ++burst)
+        {
+            printf("%8u  %6u  %8.2f  %8.2f\n", static_cast<unsigned>(sizes[size]), static_cast<unsigned>(bursts[burst]),
+                allocations_per_message<stock_manager_type>(sizes[size], bursts[burst]),
+                allocations_per_message<pooled_manager_type>(sizes[size], bursts[burst]));
+        }
+    }
+
+    printf("\nthousand messages per second, a pool per thread, hardware threads: %u\n", std::thread::hardware_concurrency());
+    printf("%8s  %8s  %10s  %10s\n", "size", "threads", "stock", "pooled");
+    const uint32_t thread_counts[] = { 1, 2, 4, 8 };
+    for (size_t size = 0; size < sizeof(sizes) / sizeof(sizes[0]); ++size)
+    {
+        for (size_t index = 0; index < sizeof(thread_counts) / sizeof(thread_counts[0]); ++index)
+        {
+            printf("%8u  %8u  %10.0f  %10.0f\n", static_cast<unsigned>(sizes[size]), thread_counts[index],
+                messages_per_second<stock_manager_type>(sizes[size], thread_counts[index]) / 1000,
+                messages_per_second<pooled_manager_type>(sizes[size], thread_counts[index]) / 1000);
+        }
+    }
+
+    return 0;
+}